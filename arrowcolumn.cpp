@@ -0,0 +1,412 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "arrowcolumn.h"
+#include "unixtime.h"
+
+#include <vector>
+#include <memory>
+#include <climits>
+#include <cstring>
+
+namespace dragonfly {
+
+namespace {
+  // What an exported schema or array owns, hung off private_data.
+  struct ArrowSchemaHolder {
+    std::string format;
+    std::string name;
+  };
+
+  struct ArrowArrayHolder {
+    std::vector<int64_t> wide;     // int64 values
+    std::vector<int32_t> narrow;   // date32 days, or utf8 offsets
+    std::vector<char> text;        // utf8 data
+    const void* buffers[3];
+  };
+
+  void releaseArrowSchema(ArrowSchema* schema)
+  {
+    delete static_cast<ArrowSchemaHolder*>(schema->private_data);
+    schema->release = 0;
+  }
+
+  void releaseArrowArray(ArrowArray* array)
+  {
+    delete static_cast<ArrowArrayHolder*>(array->private_data);
+    array->release = 0;
+  }
+
+  const char* arrowFormat(const ArrowTimeType type)
+  {
+    switch (type) {
+      case ARROW_DATE32: return "tdD";
+      case ARROW_DATE64: return "tdm";
+      case ARROW_TIMESTAMP_S: return "tss:";
+      case ARROW_TIMESTAMP_MS: return "tsm:";
+      case ARROW_TIMESTAMP_US: return "tsu:";
+      case ARROW_TIMESTAMP_NS: return "tsn:";
+      case ARROW_UTF8: return "u";
+    }
+    return "";
+  }
+
+  // The Unix epoch unit of an int64 type.
+  const EpochUnit arrowUnit(const ArrowTimeType type)
+  {
+    switch (type) {
+      case ARROW_TIMESTAMP_S: return EPOCH_SECONDS;
+      case ARROW_TIMESTAMP_US: return EPOCH_MICROS;
+      case ARROW_TIMESTAMP_NS: return EPOCH_NANOS;
+      default: return EPOCH_MILLIS;
+    }
+  }
+
+  void exportSchema(ArrowSchema* schema, const ArrowTimeType type,
+                    const std::string& name)
+  {
+    ArrowSchemaHolder* holder = new ArrowSchemaHolder;
+    holder->format = arrowFormat(type);
+    holder->name = name;
+    schema->format = holder->format.c_str();
+    schema->name = holder->name.c_str();
+    schema->metadata = 0;
+    schema->flags = 0;
+    schema->n_children = 0;
+    schema->children = 0;
+    schema->dictionary = 0;
+    schema->release = releaseArrowSchema;
+    schema->private_data = holder;
+  }
+
+  // function:  exportArray
+  // purpose:   Hands holder, whose buffers are filled in, over to array,
+  //            and the matching schema to schema.
+  //
+  void exportArray(std::unique_ptr<ArrowArrayHolder> holder, const size_t n,
+                   const ArrowTimeType type, ArrowSchema* schema,
+                   ArrowArray* array, const std::string& name)
+  {
+    exportSchema(schema, type, name);
+    array->length = static_cast<int64_t>(n);
+    array->null_count = 0;
+    array->offset = 0;
+    array->n_buffers = type == ARROW_UTF8 ? 3 : 2;
+    array->n_children = 0;
+    array->buffers = holder->buffers;
+    array->children = 0;
+    array->dictionary = 0;
+    array->release = releaseArrowArray;
+    array->private_data = holder.release();
+  }
+
+  inline packedtime_t arrowPacked(const packedtime_t t) { return t; }
+  inline packedtime_t arrowPacked(const DateTime& d) { return d.packed(); }
+
+  inline DateTime arrowDate(const packedtime_t t)
+  {
+    DateTime d;
+    d.packed(t);
+    return d;
+  }
+  inline const DateTime& arrowDate(const DateTime& d) { return d; }
+
+  template <class T>
+  void exportTimesOf(const T* times, const size_t n, const ArrowTimeType type,
+                     ArrowSchema* schema, ArrowArray* array,
+                     const std::string& name)
+  {
+    std::unique_ptr<ArrowArrayHolder> holder(new ArrowArrayHolder);
+    holder->buffers[0] = 0;   // no validity bitmap: nothing's null
+    if (type == ARROW_DATE32) {
+      holder->narrow.resize(n);
+      for (size_t i = 0; i < n; ++i) {
+        EpochCounter c;
+        c.packed(arrowPacked(times[i]));
+        const int64_t days = static_cast<int64_t>(c.days()) - UNIX_EPOCH_DAYS;
+        if (days < INT32_MIN)
+          throw DateValueOutOfRangeException();
+        holder->narrow[i] = static_cast<int32_t>(days);
+      }
+      holder->buffers[1] = holder->narrow.data();
+    }
+    else if (type == ARROW_UTF8)
+      throw DateColumnException();
+    else {
+      holder->wide.resize(n);
+      if (toUnixEpoch(times, n, arrowUnit(type), holder->wide.data()))
+        throw DateValueOutOfRangeException();
+      if (type == ARROW_DATE64) {
+        // date64 values must be whole days, so drop the times of day,
+        // rounding down before 1970 too.
+        const int64_t DAY = 86400000;
+        for (size_t i = 0; i < n; ++i) {
+          const int64_t ms = holder->wide[i];
+          holder->wide[i] = (ms / DAY - (ms % DAY < 0)) * DAY;
+        }
+      }
+      holder->buffers[1] = holder->wide.data();
+    }
+    exportArray(std::move(holder), n, type, schema, array, name);
+  }
+
+  template <class T>
+  void exportFormattedOf(const T* times, const size_t n,
+                         const DateFormatter& formatter, ArrowSchema* schema,
+                         ArrowArray* array, const std::string& name)
+  {
+    std::unique_ptr<ArrowArrayHolder> holder(new ArrowArrayHolder);
+    std::vector<int32_t>& offsets = holder->narrow;
+    std::vector<char>& text = holder->text;
+    offsets.resize(n + 1);
+    offsets[0] = 0;
+    text.reserve(n * formatter.pattern().size() + 1);
+    for (size_t i = 0; i < n; ++i) {
+      const std::string s = formatter.format(arrowDate(times[i]));
+      if (s.size() > static_cast<size_t>(INT32_MAX) - text.size())
+        throw DateValueOutOfRangeException();
+      text.insert(text.end(), s.begin(), s.end());
+      offsets[i + 1] = static_cast<int32_t>(text.size());
+    }
+    holder->buffers[0] = 0;
+    holder->buffers[1] = offsets.data();
+    holder->buffers[2] = text.data();
+    exportArray(std::move(holder), n, ARROW_UTF8, schema, array, name);
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void exportTimes(const packedtime_t* times, const size_t n,
+                 const ArrowTimeType type, ArrowSchema* schema,
+                 ArrowArray* array, const std::string& name)
+{
+  exportTimesOf(times, n, type, schema, array, name);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void exportTimes(const DateTime* dates, const size_t n,
+                 const ArrowTimeType type, ArrowSchema* schema,
+                 ArrowArray* array, const std::string& name)
+{
+  exportTimesOf(dates, n, type, schema, array, name);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void exportUnixEpoch(const int64_t* values, const size_t n,
+                     const EpochUnit unit, ArrowSchema* schema,
+                     ArrowArray* array, const std::string& name)
+{
+  static const ArrowTimeType types[] = {
+    ARROW_TIMESTAMP_S, ARROW_TIMESTAMP_MS, ARROW_TIMESTAMP_US,
+    ARROW_TIMESTAMP_NS
+  };
+  std::unique_ptr<ArrowArrayHolder> holder(new ArrowArrayHolder);
+  holder->buffers[0] = 0;
+  holder->buffers[1] = values;
+  exportArray(std::move(holder), n, types[unit], schema, array, name);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void exportFormatted(const packedtime_t* times, const size_t n,
+                     const DateFormatter& formatter, ArrowSchema* schema,
+                     ArrowArray* array, const std::string& name)
+{
+  exportFormattedOf(times, n, formatter, schema, array, name);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void exportFormatted(const DateTime* dates, const size_t n,
+                     const DateFormatter& formatter, ArrowSchema* schema,
+                     ArrowArray* array, const std::string& name)
+{
+  exportFormattedOf(dates, n, formatter, schema, array, name);
+}
+
+// function:  ArrowTimeColumn constructor
+// purpose:   Works out the type from the schema's format string, checks
+//            that the array has the buffers that type needs, and only then
+//            takes the array over, so on a throw both structs are still
+//            the caller's.
+//
+DFLY_INLINE
+ArrowTimeColumn::ArrowTimeColumn(ArrowSchema* schema, ArrowArray* array,
+                                 const DateFormatter* formatter)
+  : formatter_(formatter), validity_(0)
+{
+  if (schema == 0 || schema->release == 0 || array == 0 ||
+      array->release == 0 || schema->format == 0)
+    throw DateColumnException();
+
+  const char* format = schema->format;
+  if (!std::strcmp(format, "tdD"))
+    type_ = ARROW_DATE32;
+  else if (!std::strcmp(format, "tdm"))
+    type_ = ARROW_DATE64;
+  else if (!std::strncmp(format, "tss:", 4))
+    type_ = ARROW_TIMESTAMP_S;
+  else if (!std::strncmp(format, "tsm:", 4))
+    type_ = ARROW_TIMESTAMP_MS;
+  else if (!std::strncmp(format, "tsu:", 4))
+    type_ = ARROW_TIMESTAMP_US;
+  else if (!std::strncmp(format, "tsn:", 4))
+    type_ = ARROW_TIMESTAMP_NS;
+  else if (!std::strcmp(format, "u") && formatter)
+    type_ = ARROW_UTF8;
+  else
+    throw DateColumnException();
+
+  if (array->n_buffers != (type_ == ARROW_UTF8 ? 3 : 2) ||
+      array->n_children != 0 || array->length < 0 || array->offset < 0)
+    throw DateColumnException();
+
+  schema->release(schema);
+  array_ = *array;
+  array->release = 0;
+  if (array_.null_count != 0)
+    validity_ = static_cast<const uint8_t*>(array_.buffers[0]);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+ArrowTimeColumn::~ArrowTimeColumn()
+{
+  if (array_.release)
+    array_.release(&array_);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const size_t ArrowTimeColumn::nullCount() const
+{
+  if (array_.null_count >= 0)
+    return static_cast<size_t>(array_.null_count);
+  // -1: the producer didn't count them.
+  size_t nulls = 0;
+  for (size_t i = 0; i < size(); ++i)
+    nulls += isNull(i);
+  return nulls;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const bool ArrowTimeColumn::isNull(const size_t i) const
+{
+  if (!validity_)
+    return false;
+  const size_t bit = static_cast<size_t>(array_.offset) + i;
+  return !((validity_[bit / 8] >> (bit % 8)) & 1);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const void* ArrowTimeColumn::values() const
+{
+  if (type_ == ARROW_UTF8)
+    return 0;
+  if (type_ == ARROW_DATE32)
+    return static_cast<const int32_t*>(array_.buffers[1]) + array_.offset;
+  return static_cast<const int64_t*>(array_.buffers[1]) + array_.offset;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const EpochUnit ArrowTimeColumn::unit() const
+{
+  return arrowUnit(type_);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const DateTime ArrowTimeColumn::at(const size_t i) const
+{
+  DateTime result;
+  if (isNull(i))
+    return result;
+
+  if (type_ == ARROW_DATE32) {
+    const int64_t days =
+      static_cast<int64_t>(static_cast<const int32_t*>(values())[i])
+      + UNIX_EPOCH_DAYS;
+    if (days > INT_MAX)
+      throw DateValueOutOfRangeException();
+    result.days(static_cast<datecount_t>(days));
+  }
+  else if (type_ == ARROW_UTF8) {
+    const int32_t* offsets =
+      static_cast<const int32_t*>(array_.buffers[1]) + array_.offset;
+    const char* text = static_cast<const char*>(array_.buffers[2]);
+    result = formatter_->parse(std::string(text + offsets[i],
+                                           offsets[i + 1] - offsets[i]));
+  }
+  else {
+    unsigned char overflow;
+    fromUnixEpoch(static_cast<const int64_t*>(values()) + i, 1, unit(),
+                  &result, &overflow);
+    if (overflow)
+      throw DateValueOutOfRangeException();
+  }
+  return result;
+}
+
+// function:  toPacked
+// purpose:   int64 columns go through fromUnixEpoch in one call; the nulls
+//            are patched up afterwards, since whatever's in their slots
+//            shouldn't count as an overflow.
+//
+DFLY_INLINE
+size_t ArrowTimeColumn::toPacked(packedtime_t* out,
+                                 unsigned char* overflow) const
+{
+  const size_t n = size();
+  size_t overflows = 0;
+
+  if (type_ == ARROW_DATE32) {
+    const int32_t* days = static_cast<const int32_t*>(values());
+    for (size_t i = 0; i < n; ++i) {
+      int64_t d = static_cast<int64_t>(days[i]) + UNIX_EPOCH_DAYS;
+      const bool over = d > INT_MAX && !isNull(i);
+      if (over) {
+        d = INT_MAX;
+        ++overflows;
+      }
+      if (overflow)
+        overflow[i] = over;
+      out[i] = isNull(i) ? 0 : d * EpochCounter::TICKS_PER_DAY;
+    }
+    return overflows;
+  }
+
+  if (type_ == ARROW_UTF8) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = isNull(i) ? 0 : at(i).packed();
+      if (overflow)
+        overflow[i] = 0;
+    }
+    return 0;
+  }
+
+  std::vector<unsigned char> flags;
+  if (validity_ && !overflow) {
+    flags.resize(n);
+    overflow = flags.data();
+  }
+  overflows = fromUnixEpoch(static_cast<const int64_t*>(values()), n, unit(),
+                            out, overflow);
+  if (validity_)
+    for (size_t i = 0; i < n; ++i)
+      if (isNull(i)) {
+        out[i] = 0;
+        overflows -= overflow[i];
+        overflow[i] = 0;
+      }
+  return overflows;
+}
+
+} // namespace dragonfly
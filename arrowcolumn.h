@@ -0,0 +1,190 @@
+#ifndef __ARROWCOLUMN_H__
+#define __ARROWCOLUMN_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Timestamp columns in and out of Apache Arrow, through the Arrow C Data
+// Interface (https://arrow.apache.org/docs/format/CDataInterface.html).
+// That's a plain C ABI -- two structs and a release callback -- so nothing
+// here links against Arrow; anything that speaks the interface (pyarrow,
+// DuckDB, Polars, arrow-rs, ...) can take the arrays.
+//
+// Arrow counts from 1970 and the library counts from year 0, so packed
+// timestamps and DateTimes are always converted on export, with the bulk
+// kernels from epocharray.h, into buffers the exported array owns.  Unix
+// epoch values the caller already holds are in Arrow's layout as they are,
+// and exportUnixEpoch() hands them over without copying.  Going the other
+// way, ArrowTimeColumn reads an imported array's buffers where they lie.
+//
+// Timestamps are exported without a time zone.  Imported ones with a zone
+// are instants in UTC, per Arrow, and are read as such.
+
+#include "datetime.h"
+#include "datetypes.h"
+#include "dateexception.h"
+#include "dateformatter.h"
+#include "epocharray.h"
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+// The interface's own definitions, verbatim, guarded so they can coexist
+// with Arrow's copy of them.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C" {
+
+struct ArrowSchema {
+  // Array type description
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+} // extern "C"
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+namespace dragonfly {
+
+// The Arrow types a timestamp column can travel as.
+//
+//   ARROW_DATE32         "tdD"   int32 days since 1970; times of day dropped
+//   ARROW_DATE64         "tdm"   int64 milliseconds since 1970, in whole days
+//   ARROW_TIMESTAMP_S    "tss:"  int64 seconds since 1970
+//   ARROW_TIMESTAMP_MS   "tsm:"  int64 milliseconds
+//   ARROW_TIMESTAMP_US   "tsu:"  int64 microseconds
+//   ARROW_TIMESTAMP_NS   "tsn:"  int64 nanoseconds (about 1678 to 2262 only)
+//   ARROW_UTF8           "u"     strings, in some DateFormatter's format
+//
+enum ArrowTimeType {
+  ARROW_DATE32,
+  ARROW_DATE64,
+  ARROW_TIMESTAMP_S,
+  ARROW_TIMESTAMP_MS,
+  ARROW_TIMESTAMP_US,
+  ARROW_TIMESTAMP_NS,
+  ARROW_UTF8
+};
+
+// function:  exportTimes
+// params:    type: any but ARROW_UTF8, which throws DateColumnException
+//            (see exportFormatted instead)
+//            schema, array: filled in; the consumer releases them
+// purpose:   Converts n timestamps into a new Arrow array with no nulls.
+//            Throws DateValueOutOfRangeException, exporting nothing, if
+//            one doesn't fit the type.
+//
+void exportTimes(const packedtime_t* times, const size_t n,
+                 const ArrowTimeType type, ArrowSchema* schema,
+                 ArrowArray* array, const std::string& name = "");
+void exportTimes(const DateTime* dates, const size_t n,
+                 const ArrowTimeType type, ArrowSchema* schema,
+                 ArrowArray* array, const std::string& name = "");
+
+// function:  exportUnixEpoch
+// purpose:   Zero copy: the array's data buffer is values itself, which
+//            has to stay put until the consumer releases the array.
+//
+void exportUnixEpoch(const int64_t* values, const size_t n,
+                     const EpochUnit unit, ArrowSchema* schema,
+                     ArrowArray* array, const std::string& name = "");
+
+// function:  exportFormatted
+// purpose:   Formats n timestamps into an Arrow utf8 array.  Throws
+//            DateValueOutOfRangeException if the text passes 2GB, which is
+//            as much as utf8's 32-bit offsets can address.
+//
+void exportFormatted(const packedtime_t* times, const size_t n,
+                     const DateFormatter& formatter, ArrowSchema* schema,
+                     ArrowArray* array, const std::string& name = "");
+void exportFormatted(const DateTime* dates, const size_t n,
+                     const DateFormatter& formatter, ArrowSchema* schema,
+                     ArrowArray* array, const std::string& name = "");
+
+// class:   ArrowTimeColumn
+// purpose: An imported Arrow array of any ArrowTimeType, read in place.
+//
+//          Takes over the array, as the interface allows a consumer to:
+//          the caller's struct is marked released and this object releases
+//          the array when it's destroyed.  Only the schema's format string
+//          is needed, so the schema is released straight away.  Throws
+//          DateColumnException for other types, or for a utf8 array
+//          without a formatter to parse it with.
+//
+class ArrowTimeColumn {
+  public:
+    ArrowTimeColumn(ArrowSchema* schema, ArrowArray* array,
+                    const DateFormatter* formatter = 0);
+    ~ArrowTimeColumn();
+
+  public:
+    const ArrowTimeType type() const { return type_; }
+    const size_t size() const { return static_cast<size_t>(array_.length); }
+    const size_t nullCount() const;
+    const bool isNull(const size_t i) const;
+
+  public:
+    // A null reads as 0 A.D.  at() throws DateValueOutOfRangeException for
+    // a time DateTime can't hold, and the formatter's exceptions for text
+    // it can't parse.
+    const DateTime at(const size_t i) const;
+
+    // Converts the whole column, returning how many values didn't fit
+    // DateTime's range (see fromUnixEpoch; they're clamped and flagged in
+    // overflow).  Nulls come out as 0.
+    size_t toPacked(packedtime_t* out, unsigned char* overflow = 0) const;
+
+    // The values themselves, offset applied: int32 days for ARROW_DATE32,
+    // int64 for the others, 0 for utf8.
+    const void* values() const;
+
+  private:
+    ArrowTimeColumn(const ArrowTimeColumn&);
+    ArrowTimeColumn& operator= (const ArrowTimeColumn&);
+    const EpochUnit unit() const;
+
+  private:
+    ArrowArray array_;
+    ArrowTimeType type_;
+    const DateFormatter* formatter_;
+    const uint8_t* validity_;
+};
+
+} // namespace dragonfly
+
+#endif //__ARROWCOLUMN_H__
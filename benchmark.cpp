@@ -0,0 +1,989 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// benchmark: microbenchmarks for the calendar accessors, EpochCounter
+// arithmetic, the formatter/parser and TimeRangeFilter, Unix epoch array
+// conversion, timestamp sorting, interval queries, TimerWheel,
+// CalendarCursor, TimeMerge, ReorderBuffer, DurationHistogram, Stopwatch,
+// and the formatter's scaling across threads.
+//
+//   benchmark [-t seconds] [-j threads] [filter]
+//
+// Each benchmark runs for about the given time (default 0.25s) and prints
+// one CSV line: quoted name, iterations, ns/op, heap allocations/op and retired
+// instructions/op.  Instructions come from perf_event_open on Linux and are
+// reported as -1 where that isn't available.  Only benchmarks whose name
+// contains the filter string are run.
+//
+// The "scaling" benchmarks run the formatter on 1, 2, 4, ... threads, up to
+// -j (default: one per core), all sharing one DateFormatter.  Their ns/op is
+// wall time per operation across every thread, so perfect scaling halves it
+// each time the threads double; the efficiency against one thread goes to
+// stderr.  They don't count instructions.
+//
+// Dates come in three sets, since Gregorian::year() has fast paths for
+// 1900-1999 and 2000-2099: "1900s", "2000s", and "other" (1600-1899 and
+// 2100-2399).
+
+#include "dflydate.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <new>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <atomic>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace dragonfly;
+
+//-----------------------------------------------------------------------------
+// Every heap allocation in the process goes through here, so allocations
+// per op is just a before/after difference.  Counted per thread, so the
+// scaling benchmarks' threads don't all write the same cache line.
+//
+// They're all kept out of line: inlined, GCC would see free() or the
+// wrong delete called on what the wrong new returned, and warn
+// (-Wmismatched-new-delete).
+//
+static thread_local unsigned long long g_allocations = 0;
+
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+  ++g_allocations;
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+__attribute__((noinline)) void* operator new[](std::size_t size)
+{ return operator new(size); }
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{ std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept
+{ std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept
+{ std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, std::size_t) noexcept
+{ std::free(p); }
+
+namespace {
+
+// class:   InstructionCounter
+// purpose: Counts retired user-space instructions for this thread, when the
+//          kernel lets us.
+//
+class InstructionCounter {
+  public:
+    InstructionCounter() : fd_(-1) {
+#ifdef __linux__
+      struct perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fd_ = static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    ~InstructionCounter() {
+#ifdef __linux__
+      if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+    bool available() const { return fd_ >= 0; }
+    void start() {
+#ifdef __linux__
+      if (fd_ < 0) return;
+      ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    long long stop() {
+      long long count = -1;
+#ifdef __linux__
+      if (fd_ < 0) return -1;
+      ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (::read(fd_, &count, sizeof(count)) != sizeof(count))
+        count = -1;
+#endif
+      return count;
+    }
+  private:
+    int fd_;
+};
+
+InstructionCounter g_instructions;
+double g_seconds = 0.25;
+unsigned int g_threads = 0;  // 0: one per core
+const char* g_filter = "";
+
+// Keeps the compiler from throwing away results we never look at.
+volatile long long g_sink;
+
+// function:  run
+// params:    name: benchmark name, as printed
+//            body: body(n) performs n operations
+// purpose:   Doubles the iteration count until a run takes long enough to
+//            measure, then reports that run.
+//
+template <class Body>
+void run(const std::string& name, Body body)
+{
+  if (name.find(g_filter) == std::string::npos)
+    return;
+
+  typedef std::chrono::steady_clock clock;
+  body(1);  // warm up: lazy statics, caches.
+  for (unsigned long long n = 16; ; n *= 2) {
+    const unsigned long long allocs = g_allocations;
+    g_instructions.start();
+    const clock::time_point begin = clock::now();
+    body(n);
+    const double secs =
+      std::chrono::duration<double>(clock::now() - begin).count();
+    const long long instructions = g_instructions.stop();
+    const unsigned long long allocated = g_allocations - allocs;
+
+    if (secs >= g_seconds || n >= (1ULL << 40)) {
+      std::printf("\"%s\",%llu,%.3f,%.3f,%.1f\n", name.c_str(), n,
+                  secs * 1e9 / n, static_cast<double>(allocated) / n,
+                  instructions < 0 ? -1.0 : static_cast<double>(instructions) / n);
+      std::fflush(stdout);
+      return;
+    }
+  }
+}
+
+// Simple LCG so every run uses the same dates.
+unsigned int g_seed = 12345;
+int pick(const int lo, const int hi)
+{
+  g_seed = g_seed * 1103515245u + 12345u;
+  return lo + static_cast<int>((g_seed >> 8) % (hi - lo + 1));
+}
+
+const size_t SET_SIZE = 4096;  // power of two; indices are masked.
+
+struct DateSet {
+  std::string name;
+  std::vector<DateTime> dates;
+  std::vector<int> ymd;  // year, month, day triples for set()
+};
+
+DateSet makeSet(const std::string& name, const int lo, const int hi,
+                const int lo2 = 0, const int hi2 = -1)
+{
+  DateSet set;
+  set.name = name;
+  for (size_t i = 0; i < SET_SIZE; ++i) {
+    const int year = (hi2 >= lo2 && (i & 1)) ? pick(lo2, hi2) : pick(lo, hi);
+    const int month = pick(1, 12), day = pick(1, 28);
+    set.dates.push_back(DateTime(year, month, day, pick(0, 23),
+                                 pick(0, 59), pick(0, 59)));
+    set.ymd.push_back(year);
+    set.ymd.push_back(month);
+    set.ymd.push_back(day);
+  }
+  return set;
+}
+
+//-----------------------------------------------------------------------------
+void calendarBenchmarks(const DateSet& set)
+{
+  const std::vector<DateTime>& d = set.dates;
+  const std::vector<int>& ymd = set.ymd;
+
+  run("set/" + set.name, [&](unsigned long long n) {
+    DateTime date;
+    long long sum = 0;
+    for (unsigned long long i = 0; i < n; ++i) {
+      const size_t k = (i & (SET_SIZE - 1)) * 3;
+      date.set(ymd[k], ymd[k+1], ymd[k+2]);
+      sum += date.days();
+    }
+    g_sink = sum;
+  });
+  run("year/" + set.name, [&](unsigned long long n) {
+    long long sum = 0;
+    for (unsigned long long i = 0; i < n; ++i)
+      sum += d[i & (SET_SIZE - 1)].year();
+    g_sink = sum;
+  });
+  run("month/" + set.name, [&](unsigned long long n) {
+    long long sum = 0;
+    for (unsigned long long i = 0; i < n; ++i)
+      sum += d[i & (SET_SIZE - 1)].month();
+    g_sink = sum;
+  });
+  run("day/" + set.name, [&](unsigned long long n) {
+    long long sum = 0;
+    for (unsigned long long i = 0; i < n; ++i)
+      sum += d[i & (SET_SIZE - 1)].day();
+    g_sink = sum;
+  });
+  run("dayOfWeek/" + set.name, [&](unsigned long long n) {
+    long long sum = 0;
+    for (unsigned long long i = 0; i < n; ++i)
+      sum += d[i & (SET_SIZE - 1)].dayOfWeek();
+    g_sink = sum;
+  });
+  run("getTimeStruct/" + set.name, [&](unsigned long long n) {
+    long long sum = 0;
+    for (unsigned long long i = 0; i < n; ++i)
+      sum += d[i & (SET_SIZE - 1)].getTimeStruct().tm_mday;
+    g_sink = sum;
+  });
+}
+
+//-----------------------------------------------------------------------------
+void epochBenchmarks(const DateSet& set)
+{
+  const std::vector<DateTime>& d = set.dates;
+
+  run("EpochCounter+=/" + set.name, [&](unsigned long long n) {
+    EpochCounter acc;
+    for (unsigned long long i = 0; i < n; ++i)
+      acc += d[i & (SET_SIZE - 1)];
+    g_sink = acc.days();
+  });
+  run("EpochCounter-/" + set.name, [&](unsigned long long n) {
+    long long sum = 0;
+    for (unsigned long long i = 0; i < n; ++i) {
+      const EpochCounter diff = d[i & (SET_SIZE - 1)] - d[(i + 1) & (SET_SIZE - 1)];
+      sum += diff.days();
+    }
+    g_sink = sum;
+  });
+  run("EpochCounter</" + set.name, [&](unsigned long long n) {
+    long long sum = 0;
+    for (unsigned long long i = 0; i < n; ++i) {
+      EpochCounter a = d[i & (SET_SIZE - 1)];
+      sum += a < d[(i + 1) & (SET_SIZE - 1)];
+    }
+    g_sink = sum;
+  });
+}
+
+//-----------------------------------------------------------------------------
+void formatterBenchmarks(const DateSet& set)
+{
+  static const char* patterns[] = {
+    "%Y-%m-%d %H:%M:%S",
+    "%Y%m%d%H%M%S",
+    "%d/%b/%Y:%H:%M:%S",
+    "%A, %B %e, %Y %I:%M%p",
+  };
+  const std::vector<DateTime>& d = set.dates;
+
+  for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); ++p) {
+    const DateFormatter formatter(patterns[p]);
+    const std::string label = std::string(patterns[p]) + "/" + set.name;
+
+    run("format " + label, [&](unsigned long long n) {
+      long long sum = 0;
+      for (unsigned long long i = 0; i < n; ++i)
+        sum += formatter.format(d[i & (SET_SIZE - 1)]).size();
+      g_sink = sum;
+    });
+
+    // Every pattern here has to round-trip; a set that doesn't is a bug.
+    std::vector<std::string> texts;
+    for (size_t i = 0; i < SET_SIZE; ++i) {
+      const std::string text = formatter.format(d[i]);
+      try {
+        formatter.parse(text);
+      }
+      catch (const std::exception& e) {
+        std::cerr << "benchmark: can't parse \"" << text << "\" with \""
+                  << patterns[p] << "\": " << e.what() << std::endl;
+        std::exit(1);
+      }
+      texts.push_back(text);
+    }
+
+    run("parse " + label, [&](unsigned long long n) {
+      long long sum = 0;
+      for (unsigned long long i = 0; i < n; ++i)
+        sum += formatter.parse(texts[i & (SET_SIZE - 1)]).days();
+      g_sink = sum;
+    });
+
+    // The middle half of the set, by time.
+    std::vector<DateTime> sorted(d);
+    std::sort(sorted.begin(), sorted.end());
+    const TimeRangeFilter filter(formatter, sorted[SET_SIZE / 4],
+                                 sorted[SET_SIZE * 3 / 4]);
+    run(std::string(filter.direct() ? "range direct " : "range parsed ") +
+        label, [&](unsigned long long n) {
+      long long sum = 0;
+      for (unsigned long long i = 0; i < n; ++i)
+        sum += filter.contains(texts[i & (SET_SIZE - 1)]);
+      g_sink = sum;
+    });
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Unix epoch arrays, converted in bulk and one DateTime at a time.
+//
+void epochArrayBenchmarks()
+{
+  static const char* units[] = { "seconds", "millis", "micros", "nanos" };
+  static const int64_t scale[] = { 1, 1000, 1000000, 1000000000 };
+
+  for (int u = 0; u < 4; ++u) {
+    std::vector<int64_t> in(SET_SIZE), back(SET_SIZE);
+    for (size_t i = 0; i < SET_SIZE; ++i)
+      in[i] = (946684800LL + pick(0, 1 << 30)) * scale[u] + pick(0, 999);
+    std::vector<packedtime_t> packed(SET_SIZE);
+    std::vector<DateTime> dates(SET_SIZE);
+    const EpochUnit unit = static_cast<EpochUnit>(u);
+    const std::string label = std::string(units[u]);
+
+    run("fromUnixEpoch packed/" + label, [&](unsigned long long n) {
+      for (unsigned long long i = 0; i < n; i += SET_SIZE)
+        fromUnixEpoch(&in[0], std::min<unsigned long long>(n - i, SET_SIZE),
+                      unit, &packed[0]);
+      g_sink = packed[0];
+    });
+    run("fromUnixEpoch DateTime/" + label, [&](unsigned long long n) {
+      for (unsigned long long i = 0; i < n; i += SET_SIZE)
+        fromUnixEpoch(&in[0], std::min<unsigned long long>(n - i, SET_SIZE),
+                      unit, &dates[0]);
+      g_sink = dates[0].days();
+    });
+    run("toUnixEpoch packed/" + label, [&](unsigned long long n) {
+      for (unsigned long long i = 0; i < n; i += SET_SIZE)
+        toUnixEpoch(&packed[0], std::min<unsigned long long>(n - i, SET_SIZE),
+                    unit, &back[0]);
+      g_sink = back[0];
+    });
+  }
+
+  // The per-element way, for comparison.
+  std::vector<int64_t> millis(SET_SIZE);
+  for (size_t i = 0; i < SET_SIZE; ++i)
+    millis[i] = (946684800LL + pick(0, 1 << 30)) * 1000 + pick(0, 999);
+  run("fromUnixMillis each/millis", [&](unsigned long long n) {
+    long long sum = 0;
+    for (unsigned long long i = 0; i < n; ++i)
+      sum += fromUnixMillis(millis[i & (SET_SIZE - 1)]).days();
+    g_sink = sum;
+  });
+}
+
+// function:  sortBody
+// params:    work: scratch vector; src: the unsorted input
+//            sort: sort(work) sorts it in place
+// returns:   a benchmark body that sorts n elements' worth of src, at most
+//            src.size() at a time, each time from a fresh copy.
+//
+template <class V, class Sort>
+std::function<void(unsigned long long)> sortBody(V& work, const V& src,
+                                                 Sort sort)
+{
+  return [&work, &src, sort](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i += src.size()) {
+      const size_t m = std::min<unsigned long long>(src.size(), n - i);
+      work.assign(src.begin(), src.begin() + m);
+      sort(work);
+    }
+    g_sink = work.size();
+  };
+}
+
+//-----------------------------------------------------------------------------
+// Sorting a million timestamps, radix against std::sort.  Times are per
+// element.
+//
+void sortBenchmarks(const DateSet& set)
+{
+  const size_t N = 1 << 20;
+  std::vector<DateTime> dates(N), d;
+  std::vector<packedtime_t> times(N), t;
+  std::vector<TimeIndex> pairs(N), p;
+  for (size_t i = 0; i < N; ++i) {
+    dates[i] = set.dates[i & (SET_SIZE - 1)];
+    dates[i].ticks(pick(0, EpochCounter::TICKS_PER_DAY - 1));
+    times[i] = pairs[i].time = dates[i].packed();
+    pairs[i].index = i;
+  }
+
+  run("std::sort DateTime/" + set.name, sortBody(d, dates,
+      [](std::vector<DateTime>& v) { std::sort(v.begin(), v.end()); }));
+  run("sortTimes DateTime/" + set.name, sortBody(d, dates,
+      [](std::vector<DateTime>& v) { sortTimes(&v[0], v.size()); }));
+  run("std::sort packed/" + set.name, sortBody(t, times,
+      [](std::vector<packedtime_t>& v) { std::sort(v.begin(), v.end()); }));
+  run("sortTimes packed/" + set.name, sortBody(t, times,
+      [](std::vector<packedtime_t>& v) { sortTimes(&v[0], v.size()); }));
+  run("sortTimesParallel packed/" + set.name, sortBody(t, times,
+      [](std::vector<packedtime_t>& v) { sortTimesParallel(&v[0], v.size()); }));
+  run("std::stable_sort TimeIndex/" + set.name, sortBody(p, pairs,
+      [](std::vector<TimeIndex>& v) {
+        std::stable_sort(v.begin(), v.end(),
+          [](const TimeIndex& a, const TimeIndex& b) { return a.time < b.time; });
+      }));
+  run("sortTimes TimeIndex/" + set.name, sortBody(p, pairs,
+      [](std::vector<TimeIndex>& v) { sortTimes(&v[0], v.size()); }));
+}
+
+//-----------------------------------------------------------------------------
+// A million bookings of a minute to a day over ten years: stabbing them,
+// and set operations on two sets of 100,000 shorter ones.
+//
+void intervalBenchmarks()
+{
+  const size_t N = 1 << 20;
+  const packedtime_t from = DateTime(2010, 1, 1).packed();
+  // pick() only has 24 bits, so the day and the time of day are separate.
+  const auto instant = [from]() {
+    return from + static_cast<packedtime_t>(pick(0, 3652)) *
+           EpochCounter::TICKS_PER_DAY + pick(0, 1439) *
+           EpochCounter::TICKS_PER_MINUTE + pick(0, 59999);
+  };
+  IntervalIndex index;
+  std::vector<TimeSpan> a, b;
+  for (size_t i = 0; i < N; ++i) {
+    TimeSpan s;
+    s.begin = instant();
+    s.end = s.begin + static_cast<packedtime_t>(pick(1, 1440)) *
+            EpochCounter::TICKS_PER_MINUTE;
+    index.add(s);
+    s.end = s.begin + (s.end - s.begin) / 24;  // up to an hour, for the sets
+    if (i < 100000)
+      a.push_back(s);
+    else if (i < 200000)
+      b.push_back(s);
+  }
+  index.index();
+  std::vector<packedtime_t> instants(SET_SIZE);
+  for (size_t i = 0; i < SET_SIZE; ++i)
+    instants[i] = instant();
+
+  std::vector<size_t> ids;
+  run("IntervalIndex::stab/1M", [&](unsigned long long n) {
+    size_t found = 0;
+    for (unsigned long long i = 0; i < n; ++i) {
+      ids.clear();
+      found += index.stab(instants[i & (SET_SIZE - 1)], ids);
+    }
+    g_sink = found;
+  });
+
+  // Times are per span of input.
+  const IntervalSet x(&a[0], a.size()), y(&b[0], b.size());
+  const size_t spans = x.size() + y.size();
+  run("IntervalSet union/100k", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i += spans)
+      g_sink = (x | y).size();
+  });
+  run("IntervalSet intersection/100k", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i += spans)
+      g_sink = (x & y).size();
+  });
+  run("IntervalSet difference/100k", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i += spans)
+      g_sink = (x - y).size();
+  });
+}
+
+//-----------------------------------------------------------------------------
+void timerBenchmarks()
+{
+  // A million timeouts up to an hour out, scheduled in no particular order
+  // and then run down 10ms at a time; times are per timer.  A run that
+  // needs fewer than a million takes proportionally fewer, longer steps.
+  const size_t N = 1 << 20;
+  const packedtime_t HOUR = EpochCounter::TICKS_PER_HOUR;
+  const auto step = [&](const size_t batch) {
+    return static_cast<packedtime_t>(10 * (N / batch));
+  };
+  std::vector<packedtime_t> delays(N);
+  for (size_t i = 0; i < N; ++i)
+    delays[i] = 1 + pick(0, 3599) * EpochCounter::TICKS_PER_SECOND +
+                pick(0, 999);
+
+  TimerWheel wheel(DateTime(2010, 1, 1), N);
+  run("TimerWheel schedule+fire/1M", [&](unsigned long long n) {
+    size_t fired = 0;
+    for (unsigned long long done = 0; done < n; done += N) {
+      const size_t batch = static_cast<size_t>(std::min<unsigned long long>(N, n - done));
+      const packedtime_t start = wheel.now().packed();
+      for (size_t i = 0; i < batch; ++i)
+        wheel.schedule(start + delays[i]);
+      for (packedtime_t t = start, by = step(batch); t < start + HOUR; ) {
+        t = std::min(t + by, start + HOUR);
+        fired += wheel.advance(t, 0);
+      }
+    }
+    g_sink = fired;
+  });
+
+  std::vector<TimerId> ids(N);
+  run("TimerWheel schedule+cancel/1M", [&](unsigned long long n) {
+    for (unsigned long long done = 0; done < n; done += N) {
+      const size_t batch = static_cast<size_t>(std::min<unsigned long long>(N, n - done));
+      const packedtime_t start = wheel.now().packed();
+      for (size_t i = 0; i < batch; ++i)
+        ids[i] = wheel.schedule(start + delays[i]);
+      for (size_t i = 0; i < batch; ++i)
+        wheel.cancel(ids[i]);
+    }
+    g_sink = wheel.size();
+  });
+
+  // The heap most schedulers start with, for comparison.
+  typedef std::priority_queue<packedtime_t, std::vector<packedtime_t>,
+                              std::greater<packedtime_t> > Heap;
+  run("priority_queue push+pop/1M", [&](unsigned long long n) {
+    size_t fired = 0;
+    for (unsigned long long done = 0; done < n; done += N) {
+      const size_t batch = static_cast<size_t>(std::min<unsigned long long>(N, n - done));
+      Heap heap;
+      for (size_t i = 0; i < batch; ++i)
+        heap.push(delays[i]);
+      for (packedtime_t t = 0, by = step(batch); t < HOUR; ) {
+        t = std::min(t + by, HOUR);
+        for (; !heap.empty() && heap.top() <= t; heap.pop())
+          ++fired;
+      }
+    }
+    g_sink = fired;
+  });
+}
+
+//-----------------------------------------------------------------------------
+// A daily calendar series, stepped by CalendarCursor and by re-deriving each
+// day's fields from a DateTime.  Times are per row.
+//
+void cursorBenchmarks()
+{
+  const size_t N = 1 << 16;
+  std::vector<CalendarRow> rows(N);
+  run("CalendarCursor generate days/64k", [&](unsigned long long n) {
+    for (unsigned long long done = 0; done < n; done += N) {
+      CalendarCursor cursor(DateTime(1900, 1, 1));
+      cursor.generate(&rows[0], static_cast<size_t>(
+        std::min<unsigned long long>(N, n - done)), STEP_DAY);
+    }
+    g_sink = rows[N / 2].isoWeek;
+  });
+  run("CalendarCursor generate hours/64k", [&](unsigned long long n) {
+    for (unsigned long long done = 0; done < n; done += N) {
+      CalendarCursor cursor(DateTime(1900, 1, 1));
+      cursor.generate(&rows[0], static_cast<size_t>(
+        std::min<unsigned long long>(N, n - done)), STEP_HOUR);
+    }
+    g_sink = rows[N / 2].hour;
+  });
+  run("DateTime fields per day/64k", [&](unsigned long long n) {
+    long long sum = 0;
+    for (unsigned long long done = 0; done < n; done += N) {
+      DateTime d(1900, 1, 1);
+      const size_t batch = static_cast<size_t>(std::min<unsigned long long>(N, n - done));
+      for (size_t i = 0; i < batch; ++i) {
+        const struct tm ts = d.getTimeStruct();
+        sum += ts.tm_year + ts.tm_mon + ts.tm_mday + ts.tm_wday + ts.tm_yday;
+        d.packed(d.packed() + EpochCounter::TICKS_PER_DAY);
+      }
+    }
+    g_sink = sum;
+  });
+}
+
+//-----------------------------------------------------------------------------
+// A million records dealt out to k time-ordered sources and merged back into
+// one array, by TimeMerge and by a heap of DateTimes.  "interleaved" deals
+// one record at a time, "bursts" 64 at a time.  Times are per record.
+//
+struct HeapHead {
+  DateTime time;
+  unsigned int source;
+  size_t index;
+};
+
+struct LaterHead {
+  bool operator()(const HeapHead& a, const HeapHead& b) const
+  {
+    DateTime t(a.time);
+    return t > b.time || (!(t < b.time) && a.source > b.source);
+  }
+};
+
+void mergeBenchmarks()
+{
+  const size_t N = 1 << 20;
+  static const size_t ks[] = { 8, 64, 512 };
+  static const size_t bursts[] = { 1, 64 };
+  std::vector<packedtime_t> out(N);
+  for (size_t b = 0; b < sizeof(bursts) / sizeof(bursts[0]); ++b)
+    for (size_t kk = 0; kk < sizeof(ks) / sizeof(ks[0]); ++kk) {
+      const size_t k = ks[kk];
+      std::vector<std::vector<packedtime_t> > streams(k);
+      std::vector<std::vector<DateTime> > dates(k);
+      packedtime_t t = DateTime(2010, 1, 1).packed();
+      for (size_t i = 0; i < N; i += bursts[b]) {
+        const size_t s = pick(0, static_cast<int>(k) - 1);
+        for (size_t j = 0; j < bursts[b]; ++j) {
+          t += pick(0, 9);
+          streams[s].push_back(t);
+          dates[s].push_back(DateTime());
+          dates[s].back().packed(t);
+        }
+      }
+      std::vector<MergeSource> sources(k);
+      for (size_t s = 0; s < k; ++s) {
+        const MergeSource source = { streams[s].data(), streams[s].size(), 0 };
+        sources[s] = source;
+      }
+      char label[64];
+      std::snprintf(label, sizeof(label), "%s/k=%zu",
+                    bursts[b] == 1 ? "interleaved" : "bursts", k);
+
+      run(std::string("TimeMerge ") + label, [&](unsigned long long n) {
+        for (unsigned long long done = 0; done < n; done += N) {
+          const size_t batch = static_cast<size_t>(std::min<unsigned long long>(N, n - done));
+          TimeMerge merge(&sources[0], k);
+          MergeRun runs[64];
+          size_t o = 0;
+          for (size_t got; o < batch &&
+               (got = merge.pull(runs, std::min<size_t>(64, batch - o))) != 0; )
+            for (size_t r = 0; r < got; ++r) {
+              const packedtime_t* from = &streams[runs[r].source][0];
+              for (size_t i = runs[r].begin; i < runs[r].end && o < batch; ++i)
+                out[o++] = from[i];
+            }
+        }
+        g_sink = out[N / 2];
+      });
+
+      run(std::string("priority_queue DateTime ") + label,
+          [&](unsigned long long n) {
+        for (unsigned long long done = 0; done < n; done += N) {
+          const size_t batch = static_cast<size_t>(std::min<unsigned long long>(N, n - done));
+          std::priority_queue<HeapHead, std::vector<HeapHead>, LaterHead> heap;
+          for (size_t s = 0; s < k; ++s)
+            if (!dates[s].empty()) {
+              const HeapHead head = { dates[s][0], static_cast<unsigned int>(s), 0 };
+              heap.push(head);
+            }
+          size_t o = 0;
+          while (o < batch && !heap.empty()) {
+            HeapHead head = heap.top();
+            heap.pop();
+            out[o++] = head.time.packed();
+            if (++head.index < dates[head.source].size()) {
+              head.time = dates[head.source][head.index];
+              heap.push(head);
+            }
+          }
+        }
+        g_sink = out[N / 2];
+      });
+    }
+}
+
+//-----------------------------------------------------------------------------
+// A million events up to 2 seconds out of order, put back in order by
+// ReorderBuffer and by a heap released on the same watermark.  Times are
+// per event.
+//
+static void countEvents(const TimedEvent* events, size_t n, void* user)
+{
+  *static_cast<unsigned long long*>(user) += n + events[n - 1].time;
+}
+
+void reorderBenchmarks()
+{
+  const size_t N = 1 << 20;
+  const packedtime_t LATENESS = 2 * EpochCounter::TICKS_PER_SECOND;
+  std::vector<packedtime_t> times(N);
+  packedtime_t t = DateTime(2010, 1, 1).packed();
+  for (size_t i = 0; i < N; ++i) {
+    t += pick(0, 3);
+    times[i] = t - pick(0, static_cast<int>(LATENESS) - 1);
+  }
+
+  static const int slices[] = { 1, 100 };
+  for (size_t k = 0; k < sizeof(slices) / sizeof(slices[0]); ++k) {
+    ReorderBuffer buffer(Seconds(2), SubSeconds(slices[k]));
+    char label[64];
+    std::snprintf(label, sizeof(label), "ReorderBuffer slice=%dms/1M", slices[k]);
+    run(label, [&](unsigned long long n) {
+      unsigned long long sum = 0;
+      for (unsigned long long done = 0; done < n; done += N) {
+        const size_t batch = static_cast<size_t>(std::min<unsigned long long>(N, n - done));
+        const packedtime_t shift = static_cast<packedtime_t>(done) * 4;
+        for (size_t i = 0; i < batch; ++i) {
+          buffer.push(times[i] + shift);
+          if ((i & 255) == 255)
+            buffer.poll(countEvents, &sum);
+        }
+      }
+      g_sink = sum;
+    });
+  }
+
+  typedef std::priority_queue<packedtime_t, std::vector<packedtime_t>,
+                              std::greater<packedtime_t> > Heap;
+  run("priority_queue reorder/1M", [&](unsigned long long n) {
+    unsigned long long sum = 0;
+    for (unsigned long long done = 0; done < n; done += N) {
+      const size_t batch = static_cast<size_t>(std::min<unsigned long long>(N, n - done));
+      Heap heap;
+      packedtime_t latest = 0;
+      for (size_t i = 0; i < batch; ++i) {
+        heap.push(times[i]);
+        latest = std::max(latest, times[i]);
+        if ((i & 255) == 255)
+          for (; !heap.empty() && heap.top() < latest - LATENESS; heap.pop())
+            sum += heap.top();
+      }
+    }
+    g_sink = sum;
+  });
+}
+
+//-----------------------------------------------------------------------------
+// Latencies from a microsecond to a minute, log-uniform, into a
+// DurationHistogram and, for comparison, a vector sorted for its
+// percentiles.  Times are per value.
+//
+void histogramBenchmarks()
+{
+  const size_t N = 1 << 20;
+  std::vector<uint64_t> nanos(N);
+  for (size_t i = 0; i < N; ++i)
+    nanos[i] = static_cast<uint64_t>(1000.0 *
+      std::pow(6e7, pick(0, 1 << 20) / static_cast<double>(1 << 20)));
+
+  DurationHistogram histogram;
+  run("DurationHistogram recordNanos/1M", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; ++i)
+      histogram.recordNanos(nanos[i & (N - 1)]);
+    g_sink = histogram.percentileNanos(99);
+  });
+
+  DurationHistogram other;
+  other.merge(histogram);
+  run("DurationHistogram merge", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; ++i)
+      histogram.merge(other);
+    g_sink = histogram.count();
+  });
+
+  std::vector<uint64_t> sorted;
+  run("std::sort percentile/1M", [&](unsigned long long n) {
+    for (unsigned long long done = 0; done < n; done += N) {
+      sorted.assign(nanos.begin(), nanos.begin() +
+        static_cast<size_t>(std::min<unsigned long long>(N, n - done)));
+      std::sort(sorted.begin(), sorted.end());
+      g_sink = sorted[sorted.size() * 99 / 100];
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+// The cost of timing an empty section, per sample.
+//
+void stopwatchBenchmarks()
+{
+  StopwatchTotal total;
+  run("ScopedTimer StopwatchTotal", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; ++i) {
+      ScopedTimer timer(total);
+      g_sink = i;
+    }
+  });
+  DurationHistogram histogram;
+  run("ScopedTimer DurationHistogram", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; ++i) {
+      ScopedTimer timer(histogram);
+      g_sink = i;
+    }
+  });
+  run("steady_clock pair", [&](unsigned long long n) {
+    long long sum = 0;
+    for (unsigned long long i = 0; i < n; ++i) {
+      const std::chrono::steady_clock::time_point begin =
+        std::chrono::steady_clock::now();
+      g_sink = i;
+      sum += (std::chrono::steady_clock::now() - begin).count();
+    }
+    g_sink = sum;
+  });
+}
+
+//-----------------------------------------------------------------------------
+// function:  scale
+// params:    name: benchmark name; " x<threads>" is added
+//            body: body(n, thread) performs n operations
+// purpose:   Times body on one thread, doubling n as run() does, then runs
+//            it with the same n on each of 2, 4, ... threads at once.
+//
+template <class Body>
+void scale(const std::string& name, Body body)
+{
+  if (name.find(g_filter) == std::string::npos)
+    return;
+
+  typedef std::chrono::steady_clock clock;
+  const unsigned int most = g_threads ? g_threads :
+    std::max(1u, std::thread::hardware_concurrency());
+  unsigned long long n = 16;
+  double single = 0;  // ops per second on one thread
+  for (unsigned int threads = 1; ; ) {
+    std::atomic<unsigned int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<unsigned long long> allocs(threads);
+    std::vector<std::thread> pool;
+    for (unsigned int t = 0; t < threads; ++t)
+      pool.push_back(std::thread([&, t]() {
+        body(1, t);
+        ++ready;
+        while (!go.load(std::memory_order_acquire))
+          ;
+        const unsigned long long before = g_allocations;
+        body(n, t);
+        allocs[t] = g_allocations - before;
+      }));
+    while (ready.load() != threads)
+      std::this_thread::yield();
+    const clock::time_point begin = clock::now();
+    go.store(true, std::memory_order_release);
+    for (unsigned int t = 0; t < threads; ++t)
+      pool[t].join();
+    const double secs =
+      std::chrono::duration<double>(clock::now() - begin).count();
+
+    // One thread doubles n until it's timed long enough.
+    if (threads == 1 && secs < g_seconds && n < (1ULL << 40)) {
+      n *= 2;
+      continue;
+    }
+    const unsigned long long ops = n * threads;
+    unsigned long long allocated = 0;
+    for (unsigned int t = 0; t < threads; ++t)
+      allocated += allocs[t];
+    std::printf("\"%s x%u\",%llu,%.3f,%.3f,-1\n", name.c_str(), threads, ops,
+                secs * 1e9 / ops, static_cast<double>(allocated) / ops);
+    std::fflush(stdout);
+    const double rate = ops / secs;
+    if (threads == 1)
+      single = rate;
+    else
+      std::cerr << "benchmark: " << name << " x" << threads
+                << " scaling efficiency " << rate / (single * threads)
+                << std::endl;
+    if (threads == most)
+      return;
+    threads = std::min(most, threads * 2);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Format and parse throughput as threads are added.  Each thread works
+// through its own stretch of the dates; the formatter is shared.
+void scalingBenchmarks(const DateSet& set)
+{
+  static const char* patterns[] = {
+    "%Y-%m-%d %H:%M:%S",
+    "%A, %B %e, %Y %I:%M%p",
+  };
+  const std::vector<DateTime>& d = set.dates;
+
+  for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); ++p) {
+    const DateFormatter formatter(patterns[p]);
+    const std::string label = std::string(patterns[p]) + "/" + set.name;
+    std::vector<std::string> texts;
+    for (size_t i = 0; i < SET_SIZE; ++i)
+      texts.push_back(formatter.format(d[i]));
+
+    scale("scaling format " + label,
+          [&](unsigned long long n, unsigned int t) {
+      long long sum = 0;
+      for (unsigned long long i = 0; i < n; ++i)
+        sum += formatter.format(d[(i + t * 997) & (SET_SIZE - 1)]).size();
+      g_sink = sum;
+    });
+    scale("scaling format into buffer " + label,
+          [&](unsigned long long n, unsigned int t) {
+      char buffer[64];
+      long long sum = 0;
+      for (unsigned long long i = 0; i < n; ++i)
+        sum += formatter.format(d[(i + t * 997) & (SET_SIZE - 1)],
+                                buffer, sizeof(buffer));
+      g_sink = sum;
+    });
+    scale("scaling parse " + label,
+          [&](unsigned long long n, unsigned int t) {
+      long long sum = 0;
+      for (unsigned long long i = 0; i < n; ++i)
+        sum += formatter.parse(texts[(i + t * 997) & (SET_SIZE - 1)]).days();
+      g_sink = sum;
+    });
+  }
+}
+
+} // namespace
+
+// function:  main
+// params:    see the comment at the top of the file
+// purpose:   builds the date sets and runs every benchmark that matches.
+//
+int main(int argc, char* argv[])
+{
+  for (int arg = 1; arg < argc; ++arg) {
+    if (!std::strcmp(argv[arg], "-t") && arg + 1 < argc)
+      g_seconds = std::atof(argv[++arg]);
+    else if (!std::strcmp(argv[arg], "-j") && arg + 1 < argc)
+      g_threads = static_cast<unsigned int>(std::atoi(argv[++arg]));
+    else
+      g_filter = argv[arg];
+  }
+
+  std::vector<DateSet> sets;
+  sets.push_back(makeSet("1900s", 1900, 1999));
+  sets.push_back(makeSet("2000s", 2000, 2099));
+  sets.push_back(makeSet("other", 1600, 1899, 2100, 2399));
+
+  if (!g_instructions.available())
+    std::cerr << "benchmark: no perf counters; instructions/op is -1"
+              << std::endl;
+  std::printf("name,iterations,ns_per_op,allocs_per_op,instructions_per_op\n");
+  for (size_t s = 0; s < sets.size(); ++s) {
+    calendarBenchmarks(sets[s]);
+    epochBenchmarks(sets[s]);
+    formatterBenchmarks(sets[s]);
+    sortBenchmarks(sets[s]);
+  }
+  epochArrayBenchmarks();
+  intervalBenchmarks();
+  timerBenchmarks();
+  cursorBenchmarks();
+  mergeBenchmarks();
+  reorderBenchmarks();
+  histogramBenchmarks();
+  stopwatchBenchmarks();
+  scalingBenchmarks(sets[1]);
+  return 0;
+}
@@ -0,0 +1,171 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "calendarcursor.h"
+
+namespace dragonfly {
+
+namespace {
+  // Day 730484, January 1 2000, was a Saturday; 730484 % 7 is 6.
+  inline const int cursorDayOfWeek(const datecount_t days)
+  { return static_cast<int>((days % 7 + 7) % 7); }
+
+  // A year has 53 ISO weeks when it starts or ends on a Thursday.
+  const int cursorIsoWeeks(const int y)
+  {
+    return cursorDayOfWeek(Gregorian::countDays(y)) == 4 ||
+           cursorDayOfWeek(Gregorian::countDays(y + 1) - 1) == 4 ? 53 : 52;
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+CalendarCursor::CalendarCursor(const DateTime& start)
+  : anchorDay_(0), anchoredAt_(0)
+{
+  const struct tm ts = start.getTimeStruct();
+  row_.time = start.packed();
+  row_.hour = ts.tm_hour;
+  moveTo(ts.tm_year + 1900, ts.tm_mon + 1, ts.tm_mday);
+  anchoredAt_ = row_.time - 1;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void CalendarCursor::carryMonth()
+{
+  row_.day = 1;
+  if (++row_.month > 12) {
+    row_.month = 1;
+    ++row_.year;
+    row_.dayOfYear = 1;
+  }
+  row_.quarter = (row_.month + 2) / 3;
+  monthLength_ = Gregorian::monthLength(row_.year, row_.month);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void CalendarCursor::isoYearChanged()
+{
+  isoWeeks_ = cursorIsoWeeks(row_.isoYear);
+}
+
+// function:  moveTo
+// purpose:   Works out every field from the year, month and day, without
+//            dividing the day count back into them.
+//
+DFLY_INLINE
+void CalendarCursor::moveTo(const int year, const int month, const int day)
+{
+  const packedtime_t timeOfDay =
+    (row_.time % EpochCounter::TICKS_PER_DAY + EpochCounter::TICKS_PER_DAY) %
+    EpochCounter::TICKS_PER_DAY;
+  const int dayOfYear = Gregorian::countMonthDays(year, month) + day;
+  const datecount_t days = Gregorian::countDays(year) + dayOfYear - 1;
+
+  row_.time = static_cast<packedtime_t>(days) * EpochCounter::TICKS_PER_DAY +
+              timeOfDay;
+  row_.year = year;
+  row_.month = month;
+  row_.day = day;
+  row_.dayOfWeek = cursorDayOfWeek(days);
+  row_.dayOfYear = dayOfYear;
+  row_.quarter = (month + 2) / 3;
+  monthLength_ = Gregorian::monthLength(year, month);
+
+  // The ISO week is the one holding this week's Thursday.
+  const int isoDay = row_.dayOfWeek ? row_.dayOfWeek : 7;   // Monday is 1
+  const int week = (dayOfYear - isoDay + 10) / 7;
+  if (week < 1) {
+    row_.isoYear = year - 1;
+    row_.isoWeek = cursorIsoWeeks(year - 1);
+  }
+  else if (week > cursorIsoWeeks(year)) {
+    row_.isoYear = year + 1;
+    row_.isoWeek = 1;
+  }
+  else {
+    row_.isoYear = year;
+    row_.isoWeek = week;
+  }
+  isoYearChanged();
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void CalendarCursor::nextMonth()
+{
+  const int day = anchoredAt_ == row_.time ? anchorDay_ : row_.day;
+  const int year = row_.month == 12 ? row_.year + 1 : row_.year;
+  const int month = row_.month == 12 ? 1 : row_.month + 1;
+  const int length = Gregorian::monthLength(year, month);
+  moveTo(year, month, day < length ? day : length);
+  anchorDay_ = day;
+  anchoredAt_ = row_.time;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void CalendarCursor::nextYear()
+{
+  const int day = anchoredAt_ == row_.time ? anchorDay_ : row_.day;
+  const int length = Gregorian::monthLength(row_.year + 1, row_.month);
+  moveTo(row_.year + 1, row_.month, day < length ? day : length);
+  anchorDay_ = day;
+  anchoredAt_ = row_.time;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void CalendarCursor::next(const CalendarStep step)
+{
+  switch (step) {
+    case STEP_HOUR: nextHour(); break;
+    case STEP_DAY: nextDay(); break;
+    case STEP_MONTH: nextMonth(); break;
+    case STEP_YEAR: nextYear(); break;
+  }
+}
+
+// function:  generate
+// purpose:   One loop per step, so the day and hour loops are a copy and a
+//            handful of increments per row.
+//
+DFLY_INLINE
+void CalendarCursor::generate(CalendarRow* rows, const size_t n,
+                              const CalendarStep step)
+{
+  switch (step) {
+    case STEP_HOUR:
+      for (size_t i = 0; i < n; ++i) {
+        rows[i] = row_;
+        nextHour();
+      }
+      break;
+    case STEP_DAY:
+      for (size_t i = 0; i < n; ++i) {
+        rows[i] = row_;
+        nextDay();
+      }
+      break;
+    default:
+      for (size_t i = 0; i < n; ++i) {
+        rows[i] = row_;
+        next(step);
+      }
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const DateTime CalendarCursor::current() const
+{
+  DateTime d;
+  d.packed(row_.time);
+  return d;
+}
+
+} // namespace dragonfly
@@ -0,0 +1,122 @@
+#ifndef __CALENDARCURSOR_H__
+#define __CALENDARCURSOR_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "datetime.h"
+#include "datetypes.h"
+#include <cstddef>
+
+namespace dragonfly {
+
+// struct:  CalendarRow
+// purpose: One step of a CalendarCursor: a time and everything a calendar
+//          dimension table wants to know about it.
+//
+struct CalendarRow {
+  packedtime_t time;
+  int year;
+  int month;        // 1-12
+  int day;          // 1-31
+  int hour;         // 0-23
+  int dayOfWeek;    // 0=Sunday, as Gregorian::dayOfWeek()
+  int dayOfYear;    // 1-366
+  int isoYear;      // the ISO 8601 week-numbering year...
+  int isoWeek;      // ...and the week in it, 1-53; weeks start on Monday
+  int quarter;      // 1-4
+};
+
+enum CalendarStep { STEP_HOUR, STEP_DAY, STEP_MONTH, STEP_YEAR };
+
+// class:   CalendarCursor
+// purpose: Walks forward through the calendar an hour, day, month or year
+//          at a time, for generating date series and dimension tables.
+//
+//          The start is decomposed once, at construction.  After that the
+//          cursor keeps the year, month, day and the rest alongside the
+//          time and steps them the way a person counts: the next day is
+//          day + 1 unless that runs off the end of the month, and so on up.
+//          A day or hour step is a few increments and compares; only the
+//          rare carries into a new month or year do more.
+//
+//          Month and year steps keep the day of the month, clamped to the
+//          month's length, and remember it across a run of such steps:
+//          from January 31 the months go February 28, March 31, April 30.
+//          Every step keeps the time of day (an hour step, the minutes and
+//          seconds).
+//
+class CalendarCursor {
+  public:
+    explicit CalendarCursor(const DateTime& start);
+
+  public:
+    void nextHour();
+    void nextDay();
+    void nextMonth();
+    void nextYear();
+    void next(const CalendarStep step);
+
+    // Writes n rows, starting with the current one, into rows, stepping
+    // between them; the cursor is left one step past the last.
+    void generate(CalendarRow* rows, const size_t n, const CalendarStep step);
+
+  public:
+    const CalendarRow& row() const { return row_; }
+    const DateTime current() const;
+
+  private:
+    // Moves the calendar fields (not the time) to the next day.
+    void advanceDay();
+    // Carries a day past the end of the month into the next month.
+    void carryMonth();
+    // Moves to day of the given month, keeping the time of day.
+    void moveTo(const int year, const int month, const int day);
+    // Sets isoWeeks_ for row_.isoYear.
+    void isoYearChanged();
+
+  private:
+    CalendarRow row_;
+    int monthLength_;     // days in row_.month
+    int isoWeeks_;        // weeks in row_.isoYear
+    int anchorDay_;       // the day a run of month/year steps started on
+    packedtime_t anchoredAt_;   // where the last month/year step ended
+};
+
+//-----------------------------------------------------------------------------
+inline void CalendarCursor::nextDay()
+{
+  row_.time += EpochCounter::TICKS_PER_DAY;
+  advanceDay();
+}
+
+//-----------------------------------------------------------------------------
+inline void CalendarCursor::nextHour()
+{
+  row_.time += EpochCounter::TICKS_PER_HOUR;
+  if (++row_.hour == 24) {
+    row_.hour = 0;
+    advanceDay();
+  }
+}
+
+//-----------------------------------------------------------------------------
+inline void CalendarCursor::advanceDay()
+{
+  ++row_.dayOfYear;
+  if (++row_.dayOfWeek == 7)
+    row_.dayOfWeek = 0;
+  else if (row_.dayOfWeek == 1 && ++row_.isoWeek > isoWeeks_) {
+    row_.isoWeek = 1;
+    ++row_.isoYear;
+    isoYearChanged();
+  }
+  if (++row_.day > monthLength_)
+    carryMonth();
+}
+
+} // namespace dragonfly
+
+#endif //__CALENDARCURSOR_H__
@@ -13,6 +13,7 @@ namespace dragonfly {
   class DateValueOutOfRangeException : public DateTimeException {};
   class DateParsingException: public DateTimeException {};
   class DateBadFormatElement: public DateTimeException {};
+  class DateColumnException: public DateTimeException {};
 }
 
 #endif /*__DATEEXCEPTION_H__*/
@@ -5,9 +5,11 @@
 
 #include "dateformatter.h"
 #include "dateexception.h"
+#include "dateinstrument.h"
 
 #include <iostream>
 #include <sstream>
+#include <cstring>
 #include <functional>
 #include <algorithm>
 
@@ -41,18 +43,199 @@ namespace dragonfly {
 //       %y     last two digits of year (00..99)
 //       %Y     year (1970...)
 
+namespace {
+  // Tags format_tm writes itself; anything else goes through time_put.
+  const char DIRECT_TAGS[] = "%aAbBCdehHIjklmMnpPStwyY";
+
+  // What ends a month or day name in parsed text.
+  const char NAME_DELIMITERS[] = " ,/-.!@#$%^&*()[]{};:<>?|\\";
+
+  // function:  FormatSink
+  // purpose:   Appends to a caller's buffer, counting what doesn't fit
+  //            rather than writing it.
+  //
+  struct FormatSink {
+    char* out;
+    size_t size;
+    size_t length;
+
+    void put(const char c)
+    {
+      if (length < size)
+        out[length] = c;
+      ++length;
+    }
+    void put(const std::string& s)
+    {
+      if (length + s.size() <= size)
+        std::memcpy(out + length, s.data(), s.size());
+      else if (length < size)
+        std::memcpy(out + length, s.data(), size - length);
+      length += s.size();
+    }
+    // At least width digits, padded on the left with pad.
+    void number(unsigned int value, const unsigned int width, const char pad)
+    {
+      char digits[10];
+      unsigned int n = 0;
+      do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+      } while (value);
+      for (unsigned int i = n; i < width; ++i)
+        put(pad);
+      while (n)
+        put(digits[--n]);
+    }
+  };
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+DateFormatter::DateFormatter(const std::string& format)
+  : format_(format)
+{
+  load_names();
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+DateFormatter::DateFormatter(const std::string& format, const std::locale& loc)
+  : format_(format), loc_(loc)
+{
+  load_names();
+}
+
+// function:  load_names
+// purpose:   Has the locale put each name once, the way LocaleParser does,
+//            and decides whether format can skip time_put altogether.
+//
+DFLY_INLINE
+void DateFormatter::load_names()
+{
+  TimeStruct ts;
+  std::ostringstream os;
+  os.imbue(loc_);
+  std::time_put<char> const& facet =
+    std::use_facet< std::time_put<char> >(os.getloc());
+
+  const char tags[] = "aAbBpP";
+  for (int t = 0; t < 6; ++t) {
+    const char pat[2] = { '%', tags[t] };
+    const int count = t < 2 ? 7 : t < 4 ? 12 : 2;
+    for (int x = 0; x < count; ++x) {
+      ts.tm_wday = x;
+      ts.tm_mon = x;
+      ts.tm_hour = x ? 13 : 0;
+      facet.put(os, os, os.fill(), &ts, pat, pat + sizeof(pat));
+      std::string& name =
+        t < 2 ? weekdays_[t][x] : t < 4 ? months_[t - 2][x] : ampm_[t - 4][x];
+      name = os.str();
+      os.str("");
+    }
+  }
+
+  direct_ = true;
+  for (size_t i = 0; i < format_.size() && direct_; ++i)
+    if (format_[i] == '%')
+      direct_ = ++i < format_.size() &&
+                std::strchr(DIRECT_TAGS, format_[i]) != 0;
+}
+
 // function: format
 // params:   DateTime object
 // returns:  A string, formatted as specified by format_ instance variable.
 // purpose:  Pass in a DateTime, returns a text string representation of that
 //           calendar date and/or time.
 //
-const std::string DateFormatter::format(const DateTime& date)
+DFLY_INLINE
+const std::string DateFormatter::format(const DateTime& date) const
 { 
+  DFLY_INSTRUMENT_SCOPE(scope, FORMAT, *this);
+  const std::tm ts = date.getTimeStruct();
+  char buffer[128];
+  const size_t length = format_tm(ts, buffer, sizeof(buffer));
+  DFLY_INSTRUMENT_BYTES(scope, length);
+  if (length < sizeof(buffer))
+    return std::string(buffer, length);
+
+  std::string result(length, '\0');
+  format_tm(ts, &result[0], length + 1);
+  return result; 
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+size_t DateFormatter::format(const DateTime& date, char* out,
+                             const size_t size) const
+{
+  DFLY_INSTRUMENT_SCOPE(scope, FORMAT, *this);
+  const size_t length = format_tm(date.getTimeStruct(), out, size);
+  DFLY_INSTRUMENT_BYTES(scope, length);
+  return length;
+}
+
+// function:  format_tm
+// purpose:   Writes each tag straight from the time struct and the name
+//            tables, byte for byte what time_put writes for them.
+//
+DFLY_INLINE
+size_t DateFormatter::format_tm(const std::tm& ts, char* out,
+                                const size_t size) const
+{
+  if (!direct_)
+    return format_stream(ts, out, size);
+
+  FormatSink sink = { out, size, 0 };
+  const int year = ts.tm_year + 1900;
+  for (size_t i = 0; i < format_.size(); ++i) {
+    if (format_[i] != '%') {
+      sink.put(format_[i]);
+      continue;
+    }
+    switch (format_[++i]) {
+      case '%': sink.put('%'); break;
+      case 'a': sink.put(weekdays_[0][ts.tm_wday]); break;
+      case 'A': sink.put(weekdays_[1][ts.tm_wday]); break;
+      case 'b':
+      case 'h': sink.put(months_[0][ts.tm_mon]); break;
+      case 'B': sink.put(months_[1][ts.tm_mon]); break;
+      // Neither %C nor %Y is padded, as with strftime.
+      case 'C': sink.number(year / 100, 1, '0'); break;
+      case 'd': sink.number(ts.tm_mday, 2, '0'); break;
+      case 'e': sink.number(ts.tm_mday, 2, ' '); break;
+      case 'H': sink.number(ts.tm_hour, 2, '0'); break;
+      case 'I': sink.number((ts.tm_hour + 11) % 12 + 1, 2, '0'); break;
+      case 'j': sink.number(ts.tm_yday + 1, 3, '0'); break;
+      case 'k': sink.number(ts.tm_hour, 2, ' '); break;
+      case 'l': sink.number((ts.tm_hour + 11) % 12 + 1, 2, ' '); break;
+      case 'm': sink.number(ts.tm_mon + 1, 2, '0'); break;
+      case 'M': sink.number(ts.tm_min, 2, '0'); break;
+      case 'n': sink.put('\n'); break;
+      case 'p': sink.put(ampm_[0][ts.tm_hour >= 12]); break;
+      case 'P': sink.put(ampm_[1][ts.tm_hour >= 12]); break;
+      case 'S': sink.number(ts.tm_sec, 2, '0'); break;
+      case 't': sink.put('\t'); break;
+      case 'w': sink.number(ts.tm_wday, 1, '0'); break;
+      case 'y': sink.number(year % 100, 2, '0'); break;
+      case 'Y': sink.number(year, 1, '0'); break;
+    }
+  }
+  if (sink.length < size)
+    out[sink.length] = '\0';
+  return sink.length;
+}
+
+// function:  format_stream
+// purpose:   The general case, for patterns with tags format_tm doesn't
+//            know: hands the whole pattern to the locale's time_put.
+//
+DFLY_INLINE
+size_t DateFormatter::format_stream(const std::tm& ts, char* out,
+                                    const size_t size) const
+{
   std::ostringstream os;
-  
-  // Get a copy of the date held by the formatter converted to a POSIX thing...
-  std::tm ts = date.getTimeStruct();
+  os.imbue(loc_);
 
   // Get the facet that is currently installed on this output stream.
   std::time_put<char> const& facet = 
@@ -64,22 +247,73 @@ const std::string DateFormatter::format(const DateTime& date)
   if (facet.put(os, os, os.fill(), &ts, pat_beg, pat_end).failed())
     os.setstate(os.badbit);
 
-  return os.str(); 
+  const std::string result = os.str();
+  FormatSink sink = { out, size, 0 };
+  sink.put(result);
+  if (sink.length < size)
+    out[sink.length] = '\0';
+  return sink.length;
 }
 
 // function: parse
 // params:   text: string containing a text representation of a date, to be
 //                 parsed.
-//           loc: an optional locale object.  If not provided, the method
-//                will retrieve the default locale.
 // returns:  A DateTime object parsed from the string supplied to the method.
 // purpose:  Reads a text representaion of a date in the supplied string, and
 //           returns a DateTime object set to the date and time described by
 //           that string.
 //
+DFLY_INLINE
+const DateTime DateFormatter::parse(const std::string& text) const
+{ 
+  unsigned int length;
+  return parse(text.data(), text.size(), length);
+}
+
+// function: parse
+// params:   text: string beginning with the date to be parsed.
+//           length: set to the number of characters the date occupied.
+// returns:  A DateTime object parsed from the start of the string.
+// purpose:  Same as above, for callers that need to know where the date
+//           ended, e.g. to pick it out of a longer line of text.
+//
+DFLY_INLINE
 const DateTime DateFormatter::parse(const std::string& text, 
-                                    const std::locale& loc /* = std::locale() */ )
+                                    unsigned int& length) const
+{ 
+  return parse(text.data(), text.size(), length);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const DateTime DateFormatter::parse(const std::string& text, 
+                                    const std::locale& /* loc */) const
+{ 
+  unsigned int length;
+  return parse(text.data(), text.size(), length);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const DateTime DateFormatter::parse(const std::string& text, 
+                                    unsigned int& length,
+                                    const std::locale& /* loc */) const
+{ 
+  return parse(text.data(), text.size(), length);
+}
+
+// function: parse
+// params:   text, size: the characters to parse, which needn't be
+//           NUL-terminated.
+//           length: set to the number of characters the date occupied.
+// purpose:  Reads the text in place: fields are handed to parse_field as
+//           pointers into it, never copied out.
+//
+DFLY_INLINE
+const DateTime DateFormatter::parse(const char* text, const size_t size,
+                                    unsigned int& length) const
 { 
+  DFLY_INSTRUMENT_SCOPE(scope, PARSE, *this);
 #if __USE_STRPTIME
 	//
 	// Some C libraries come with a function called strptime, which does all
@@ -88,15 +322,17 @@ const DateTime DateFormatter::parse(const std::string& text,
   // Good luck.  Let me know if it works.
 	//
   struct tm ts;
-  char* end = std::strptime(s.c_str(), format_.c_str(), &ts);
+  const std::string copy(text, size);
+  char* end = std::strptime(copy.c_str(), format_.c_str(), &ts);
   if (end == 0)
     throw DateParsingException();
+  length = end - copy.c_str();
   return DateTime(ts);
 #else
  	TimeStruct ts; 	 
-	unsigned int ti = 0;  // text (input) string index.  
+	size_t ti = 0;  // text (input) string index.  
+  AmPm ampm = AMPM_NONE;
 
-  // TODO - I probably oughtta use iterators instead of character indexes.
   for (unsigned int fi = 0; fi < format_.size(); ++fi) {
     //
     // The format string will consist of one of the following:
@@ -111,6 +347,7 @@ const DateTime DateFormatter::parse(const std::string& text,
     //    4.) A percent sign followed by another percent sign.
     //        This is interpreted as a literal %
     //
+    // Past the end of the text reads as NUL, as std::string's would.
     char fmt_el = format_[fi];
     switch (fmt_el) {
       case ' ':
@@ -121,14 +358,15 @@ const DateTime DateFormatter::parse(const std::string& text,
         // still whitespace, back up the format pointer and keep trying.  otherwise,
         // move onto the next formatting element.
         //
-        ++ti;
-        if (text[ti] == ' ' || text[ti] =='\t' || text[ti] == '\n' || text[ti] == '\r')
+        if (++ti < size &&
+            (text[ti] == ' ' || text[ti] =='\t' || text[ti] == '\n' || text[ti] == '\r'))
           --fi;
         break;
       case '%':
         ++fi;
         if (format_[fi] != '%') {
-	        ti += parse_datepart(format_[fi],text.substr(ti,text.size()),loc,ts);
+          const size_t at = ti < size ? ti : size;
+	        ti += parse_field(format_[fi], text + at, size - at, ts, ampm);
           break;
         }         	
         else
@@ -136,7 +374,7 @@ const DateTime DateFormatter::parse(const std::string& text,
 					;
       default:
         // ordinary character
-        if (text[ti] != format_[fi])
+        if (ti >= size || text[ti] != format_[fi])
         	throw DateBadFormatElement();
         else {
         	++ti;
@@ -144,10 +382,163 @@ const DateTime DateFormatter::parse(const std::string& text,
     }
   }
 
-  // get_date from the stream and output tm contents.
-  //tg.get_date(begin, end, is, state, &s);
+  // The hour is on the 12-hour clock if there was an AM/PM indicator,
+  // which may have come before it.
+  if (ampm == AMPM_PM && ts.tm_hour < 12)
+    ts.tm_hour += 12;
+  else if (ampm == AMPM_AM && ts.tm_hour == 12)
+    ts.tm_hour = 0;
+
+  // A day of the year (still 1-based here) gives the month and day, once
+  // the year's known.
+  if (ts.tm_yday) {
+    if (ts.tm_yday > Gregorian::countMonthDays(ts.tm_year, 13))
+      throw DateValueOutOfRangeException();
+    ts.tm_mon = 1;
+    while (ts.tm_yday > Gregorian::countMonthDays(ts.tm_year, ts.tm_mon + 1))
+      ++ts.tm_mon;
+    ts.tm_mday = ts.tm_yday - Gregorian::countMonthDays(ts.tm_year, ts.tm_mon);
+  }
+
+  length = static_cast<unsigned int>(ti);
   return DateTime(ts.tm_year, ts.tm_mon, ts.tm_mday, ts.tm_hour, ts.tm_min, ts.tm_sec);
 #endif  // __USE_STRPTIME
 }
 
+// function:  parse_field
+// params:    fmt: the tag's character
+//            text, size: the rest of the text
+//            ts: where the field goes
+//            ampm: set if the field's an AM/PM indicator
+// returns:   Number of characters read and parsed
+//
+DFLY_INLINE
+unsigned int DateFormatter::parse_field(const char fmt, const char* text,
+                                        const size_t size, std::tm& ts,
+                                        AmPm& ampm) const
+{
+  // specialize a converter for each numeric field we parse.
+	typedef Convert<2,1,31> DayOfMonth;
+	typedef Convert<2,1,12> MonthOfYear;
+  typedef Convert<3,1,366> DayOfYear;
+	typedef Convert<4,0,9999> Year;
+  typedef Convert<2,0,99> LittleYear;
+	typedef Convert<2,0,99> Century;
+	typedef Convert<2,0,23> Hour;
+	typedef Convert<2,1,12> SemiHour;
+	typedef Convert<2,0,59> Minute;
+	typedef Convert<2,0,59> Second;
+
+  switch (fmt) {
+    case 'a':
+      // weekday name (a=abbrev, A=full)
+      return parse_name(weekdays_[0], 7, text, size, ts.tm_wday);
+    case 'A':
+      return parse_name(weekdays_[1], 7, text, size, ts.tm_wday);
+    case 'b':
+    case 'h':
+      // month name (b,h=abbrev, B=full)
+      return parse_name(months_[0], 12, text, size, ts.tm_mon);
+    case 'B':
+      return parse_name(months_[1], 12, text, size, ts.tm_mon);
+    case 'C':
+      // century (year divided by  100  and  truncated  to  an  integer)
+      return Century::get(text, size, ts.tm_year);
+    case 'd':
+    case 'e':
+      // day of month, zero padded.
+      return DayOfMonth::get(text, size, ts.tm_mday);
+    case 'H':
+      // hour (00..23)
+    case 'k':
+      // hour, blank padded, ( 0..23)
+      return Hour::get(text, size, ts.tm_hour);
+    case 'l':
+    case 'I':
+      // I: hour (01..12)
+      // l: hour, blank padded, ( 1..12)
+      return SemiHour::get(text, size, ts.tm_hour);
+    case 'j':
+      // day of year (001..366); parse turns it into a month and day.
+      return DayOfYear::get(text, size, ts.tm_yday);
+    case 'm':
+      // month, (01..12)
+      return MonthOfYear::get(text, size, ts.tm_mon);
+    case 'M':
+      // minute, (00..59)
+      return Minute::get(text, size, ts.tm_min);
+    case 'p':
+    case 'P':
+      // p: locale's upper case AM or PM indicator (may be blank)
+      // P: locale's lower case am or pm indicator (may be blank)
+      return match_ampm(text, size, ampm);
+    case 'S':
+      // seconds (00..59)
+      return Second::get(text, size, ts.tm_sec); 
+    case 'Y':
+      // year (e.g., 1970..)
+      return Year::get(text, size, ts.tm_year);
+    case 'y':
+      { // scope
+        // last two digits of the year (e.g., 70...).
+        int year = 0;
+        const unsigned int retval = LittleYear::get(text, size, year);
+        if (year < WRAP_)
+          ts.tm_year = year + 2000;
+        else
+          ts.tm_year = year + 1900;
+        return retval;
+      }
+    default:
+      throw DateBadFormatElement();
+  } 
+}
+
+// function:  parse_name
+// purpose:   Matches the word at the start of text, up to the first
+//            delimiter, against one of the name tables.  value is set to
+//            the name's index plus one, as LocaleParser does.
+//
+DFLY_INLINE
+unsigned int DateFormatter::parse_name(const std::string* names,
+                                       const int count, const char* text,
+                                       const size_t size, int& value) const
+{
+  size_t n = 0;
+  while (n < size && !std::strchr(NAME_DELIMITERS, text[n]))
+    ++n;
+  for (int i = 0; i < count; ++i)
+    if (names[i].size() == n && !names[i].compare(0, n, text, n)) {
+      value = i + 1;
+      return static_cast<unsigned int>(n);
+    }
+  throw DateParsingException();
+}
+
+// function:  match_ampm
+// purpose:   Reads whichever AM/PM indicator, upper or lower case, starts
+//            the text.  A locale without indicators reads nothing; one with
+//            them throws DateParsingException if none is there.
+//
+DFLY_INLINE
+unsigned int DateFormatter::match_ampm(const char* text, const size_t size,
+                                       AmPm& ampm) const
+{
+  bool any = false;
+  for (int pm = 1; pm >= 0; --pm)
+    for (int c = 0; c < 2; ++c) {
+      const std::string& s = ampm_[c][pm];
+      if (s.empty())
+        continue;
+      any = true;
+      if (s.size() <= size && !s.compare(0, s.size(), text, s.size())) {
+        ampm = pm ? AMPM_PM : AMPM_AM;
+        return static_cast<unsigned int>(s.size());
+      }
+    }
+  if (any)
+    throw DateParsingException();
+  return 0;
+}
+
 } // namespace dragonfly
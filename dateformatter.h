@@ -13,6 +13,8 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <cstring>
+#include <stdint.h>
 
 namespace dragonfly {
 
@@ -53,20 +55,57 @@ namespace dragonfly {
 //
 class DateFormatter {
 	public:
-    DateFormatter(const std::string& format) : format_(format) {}
+    // The locale's month and day names and AM/PM indicators are looked up
+    // once, here, and kept by the formatter; format and parse never touch
+    // a std::locale or a stream for the tags above.  Without a locale the
+    // global one at the time of construction is used.
+    DateFormatter(const std::string& format);
+    DateFormatter(const std::string& format, const std::locale& loc);
   public:
-    const std::string format(const DateTime& date);
+    const std::string format(const DateTime& date) const;
+    // Writes the text and a NUL into out, without allocating, and returns
+    // the length of the whole text: if that's size or more, it didn't all
+    // fit (as with snprintf).
+    size_t format(const DateTime& date, char* out, const size_t size) const;
   public:
-    const DateTime parse(const std::string& text, 
-                         const std::locale& loc = std::locale());
+    const DateTime parse(const std::string& text) const;
+    const DateTime parse(const std::string& text, unsigned int& length) const;
+    const DateTime parse(const char* text, const size_t size,
+                         unsigned int& length) const;
+    // loc is ignored; names are always the formatter's own.
+    const DateTime parse(const std::string& text,
+                         const std::locale& loc) const;
+    const DateTime parse(const std::string& text, unsigned int& length,
+                         const std::locale& loc) const;
     unsigned int parse_datepart(const char fmt, const std::string& text,
-                                const std::locale& loc, std::tm& ts);
+                                const std::locale& loc, std::tm& ts) const;
     unsigned int parse_ampm(const std::string& text, const std::locale& loc, 
-                            std::tm& ts);
+                            std::tm& ts) const;
+  public:
+    const std::string& pattern() const { return format_; }
   private:
+    friend class StreamingDateParser;
+    friend class StaticDateFormatterBase;
     static const int WRAP_ = 50;  // where we split the century on two-digit years.
+    enum AmPm { AMPM_NONE, AMPM_AM, AMPM_PM };
+  private:
+    void load_names();
+    size_t format_tm(const std::tm& ts, char* out, const size_t size) const;
+    size_t format_stream(const std::tm& ts, char* out, const size_t size) const;
+    unsigned int parse_field(const char fmt, const char* text,
+                             const size_t size, std::tm& ts, AmPm& ampm) const;
+    unsigned int parse_name(const std::string* names, const int count,
+                            const char* text, const size_t size,
+                            int& value) const;
+    unsigned int match_ampm(const char* text, const size_t size,
+                            AmPm& ampm) const;
   private:
     std::string format_;
+    std::locale loc_;
+    bool direct_;  // format_ only uses tags format_tm writes itself
+    std::string weekdays_[2][7];  // abbreviated, full
+    std::string months_[2][12];
+    std::string ampm_[2][2];      // %p, %P; each AM then PM
 };
 
 // class:   TimeStruct
@@ -143,9 +182,28 @@ class LocaleParser {
         return pos;
       }
       else {
+        DFLY_COUNT(EXCEPTIONS);
         throw DateParsingException();
       }
     }
+
+    // Same lookup as get_val, but for a name that's already been split off
+    // from the surrounding text.  Returns false instead of throwing.
+    bool find(const std::string& name, int& output) {
+      if (names_.empty()) {
+        load();
+      }
+
+      std::map<std::string,int>::const_iterator i = names_.find(name);
+      if (i == names_.end())
+        return false;
+      output = i->second;
+      return true;
+    }
+
+    bool is_delim(const char c) const {
+      return delim.find(c) != std::string::npos;
+    }
 };
 
 // Specialize one LocaleParser for each type of thing we're parsing...
@@ -154,214 +212,185 @@ typedef LocaleParser<'B',12> FullMonth;
 typedef LocaleParser<'a',7> AbbrevWeekday;
 typedef LocaleParser<'A',7> FullWeekday;
 
+// Leniency of a Convert.
+//   CONVERT_STRICT:  the field is exactly `digits` characters wide: digits,
+//                    optionally blank padded on the left (" 5" for %e).
+//   CONVERT_LENIENT: blanks, then 1 to `digits` digits, stopping at the
+//                    first non-digit, so %m/%d takes 5/4 as well as 05/04.
+//
+enum ConvertMode {
+  CONVERT_STRICT,
+  CONVERT_LENIENT
+};
+
+namespace detail {
+  // function:  load8
+  // purpose:   Up to 8 bytes of s as a little-endian word, zero filled past
+  //            the end so nothing beyond s is read.
+  //
+  inline uint64_t load8(const char* s, const size_t length)
+  {
+    uint64_t word = 0;
+    if (length >= 8) {
+      std::memcpy(&word, s, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      word = __builtin_bswap64(word);
+#endif
+    }
+    else
+      for (size_t i = 0; i < length; ++i)
+        word |= static_cast<uint64_t>(static_cast<unsigned char>(s[i])) << (8 * i);
+    return word;
+  }
+
+  // function:  nonDigits
+  // returns:   the word with the high bit set in each byte that isn't
+  //            '0'..'9', and every other bit clear.
+  // purpose:   A byte is a digit when its high nibble is 3 and adding 6
+  //            doesn't carry out of the low nibble.  A carry out of a
+  //            non-digit byte can spoil the flag of the byte after it, so
+  //            only the flags up to the first non-digit can be trusted.
+  //
+  inline uint64_t nonDigits(const uint64_t word)
+  {
+    const uint64_t nibbles = 0xF0F0F0F0F0F0F0F0ULL;
+    const uint64_t threes = 0x3030303030303030ULL;
+    const uint64_t bad = ((word & nibbles) ^ threes) |
+      (((word + 0x0606060606060606ULL) & nibbles) ^ threes);
+    // High bit of each byte that's non-zero in bad, without carries.
+    const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+    return (((bad & low7) + low7) | bad) & ~low7;
+  }
+
+  // function:  digitsValue<width>
+  // params:    width: 1, 2, 4 or 8, at least the field's digits
+  //            word: as from load8, n: 1..width leading bytes that are
+  //            digits; the rest of the word is ignored
+  // purpose:   Combines neighbouring digits pairwise: 8 digits become 4
+  //            two-digit numbers, then 2 four-digit ones, then one.  A
+  //            narrower field needs fewer rounds.
+  //
+  template <unsigned int width>
+  inline unsigned int digitsValue(uint64_t word, const unsigned int n)
+  {
+    word -= 0x3030303030303030ULL;
+    // Slide the n digits up so the bytes below them read as leading zeros,
+    // and drop whatever followed them.
+    word <<= 8 * (width - n);
+    if (width < 8)
+      word &= (1ULL << (8 * (width & 7))) - 1;
+    if (width >= 2)
+      word = (word * 10 + (word >> 8)) & 0x00FF00FF00FF00FFULL;
+    if (width >= 4)
+      word = (word * 100 + (word >> 16)) & 0x0000FFFF0000FFFFULL;
+    if (width >= 8)
+      word = (word * 10000 + (word >> 32)) & 0x00000000FFFFFFFFULL;
+    return static_cast<unsigned int>(word);
+  }
+}
+
+// class:   Convert<digits,min,max>
+// purpose: Reads a numeric date field of up to `digits` digits (at most 8)
+//          and checks that it's in [min, max], eight bytes at a time rather
+//          than one.  Returns the number of characters consumed, blanks
+//          included.  Throws DateParsingException if the text doesn't hold
+//          a field, and DateValueOutOfRangeException if the value's out of
+//          bounds -- so a month of 99 is caught here, not later on.
+//
 // GNU compiler doesn't let me next this inside the parse_datepart method.
 template<unsigned int digits, unsigned int min, unsigned int max>
 class Convert {
-	public:
-		// wanted this thing to work even when non-numerics appeared.  
-		static unsigned int get(const std::string& s, int& i) {
-			i = 0;
-      int j = 0;
-			for (unsigned int pos=0; pos<digits; ++pos) {
-				if (isdigit(s[pos])) {
-				  i *= 10;
-					i += s[pos] - '0';
-				  ++j;
-        }
-			}
-      return j;
-		}
+  static_assert(digits >= 1 && digits <= 8, "Convert reads 1 to 8 digits");
+  public:
+    static unsigned int get(const char* s, const size_t length, int& i,
+                            const ConvertMode mode = CONVERT_LENIENT) {
+      const uint64_t word = detail::load8(s, length);
+      if (detail::nonDigits(word) & FIELD)
+        return getShort(s, length, i, mode);
+      // The usual case: the whole field is digits.
+      return store(detail::digitsValue<WIDTH>(word, digits), digits, i);
+    }
+    static unsigned int get(const std::string& s, int& i,
+                            const ConvertMode mode = CONVERT_LENIENT) {
+      return get(s.data(), s.size(), i, mode);
+    }
+
+  private:
+    static constexpr unsigned int WIDTH =
+      digits <= 1 ? 1 : digits <= 2 ? 2 : digits <= 4 ? 4 : 8;
+    static constexpr uint64_t FIELD =
+      digits == 8 ? ~0ULL : (1ULL << (8 * digits)) - 1;
+
+    // Blank padded, or cut short by a non-digit.
+    static unsigned int getShort(const char* s, const size_t length, int& i,
+                                 const ConvertMode mode) {
+      unsigned int blanks = 0;
+      while (blanks < length && blanks < digits - 1 && s[blanks] == ' ')
+        ++blanks;
+      const uint64_t word = detail::load8(s + blanks, length - blanks);
+      const uint64_t bad = detail::nonDigits(word) & (FIELD >> (8 * blanks));
+      const unsigned int n = bad ? __builtin_ctzll(bad) / 8 : digits - blanks;
+      if (n == 0 || (mode == CONVERT_STRICT && blanks + n != digits)) {
+        DFLY_COUNT(EXCEPTIONS);
+        throw DateParsingException();
+      }
+      return store(detail::digitsValue<WIDTH>(word, n), blanks + n, i);
+    }
+
+    static unsigned int store(const unsigned int value,
+                              const unsigned int used, int& i) {
+      if (value < min || value > max) {
+        DFLY_COUNT(EXCEPTIONS);
+        throw DateValueOutOfRangeException();
+      }
+      i = static_cast<int>(value);
+      return used;
+    }
 };
 
 // function:  DateFormatter:parse_datepart
 // params:    fmt: a single format character (see class def. for valid contents)
 //            text: string to parse for this portion of the date
-//            loc: locale object
+//            loc: unused; the formatter's own names are used.
 //            ts: POSIX time struct for storage of results.
-// called by: DateFormatter::parse
 // returns:   Number of characters read and parsed
-// purpose:   The parse method reads through the format string for characters
-//            following a % character which are not themselves % characters.
-//            When it encounters one, it calls this method with the remaining
-//            unparsed date string along with the character describing the
-//            expected date field.  The method reads the string for digits
-//            or text corresponding to the format character and populates the
-//            timestruct passed to it.
+// purpose:   Reads the one date field described by fmt from the start of
+//            text, and populates the timestruct passed to it.  An AM/PM
+//            indicator moves ts.tm_hour onto the 24-hour clock straight
+//            away, so it has to come after the hour.  (parse itself reads
+//            fields with parse_field and applies AM/PM at the end.)
 //
 inline 
 unsigned int DateFormatter::parse_datepart(const char fmt, 
                                            const std::string& text,
-                                           const std::locale& loc, std::tm& ts) 
+                                           const std::locale& /* loc */, 
+                                           std::tm& ts) const
 {
-  // specialize a converter for each numeric field we parse.
-	typedef Convert<2,1,31> DayOfMonth;
-	typedef Convert<3,1,366> DayOfYear;
-	typedef Convert<2,1,12> MonthOfYear;
-	typedef Convert<4,0,9999> Year;
-  typedef Convert<2,0,99> LittleYear;
-	typedef Convert<2,0,99> Century;
-	typedef Convert<2,0,23> Hour;
-	typedef Convert<2,1,12> SemiHour;
-	typedef Convert<2,0,59> Minute;
-	typedef Convert<2,0,59> Second;
-	
-  // Local versions of the locale-based string parsers.
-  static AbbrevMonth abbrev_month;
-  static FullMonth full_month;
-  static AbbrevWeekday abbrev_weekday;
-  static FullWeekday full_weekday;
-
-  switch (fmt) {
-    case 'a':
-      // weekday name (a=abbrev, A=full)
-      return abbrev_weekday.get_val(text, ts.tm_wday);
-      break;
-    case 'A':
-      // weekday name (a=abbrev, A=full)
-      return full_weekday.get_val(text, ts.tm_wday);
-      break;
-    case 'b':
-    case 'h':
-      // month name (b,h=abbrev, B=full)
-      return abbrev_month.get_val(text, ts.tm_mon);
-      break;
-    case 'B':
-      // month name (b,h=abbrev, B=full)
-      return full_month.get_val(text, ts.tm_mon);
-      break;
-    case 'C':
-      // century (year divided by  100  and  truncated  to  an  integer)
-      return Century::get(text, ts.tm_year);
-      break;     
-    case 'd':
-    case 'e':
-      // day of month, zero padded.
-      return DayOfMonth::get(text, ts.tm_mday);
-      break;
-    case 'H':
-      // hour (00..23)
-    case 'k':
-      // hour, blank padded, ( 0..23)
-      return Hour::get(text, ts.tm_hour);
-      break;
-    case 'l':
-    case 'I':
-      // I: hour (01..12)
-      // l: hour, blank padded, ( 1..12)
-      return SemiHour::get(text, ts.tm_hour);
-      break;
-    case 'j':
-      // day of year (001..366)  <<TODO>>
-      //ts.day = DayOfYear::get(text[offset]);
-      //break;
-    case 'm':
-      // month, (01..12)
-      return MonthOfYear::get(text, ts.tm_mon);
-      break;
-    case 'M':
-      // minute, (00..59)
-      return Minute::get(text, ts.tm_min);
-      break;
-    case 'p':
-    case 'P':
-      // p: locale's upper case AM or PM indicator (may be blank)
-      // P: locale's lower case am or pm indicator (may be blank)
-      return parse_ampm(text, loc, ts);
-      break;
-    case 'S':
-      // seconds (00..59)
-      return Second::get(text, ts.tm_sec); 
-      break;
-    case 'Y':
-      // year (e.g., 1970..)
-      return Year::get(text,ts.tm_year);
-      break;
-    case 'y':
-      { // scope
-        // last two digits of the year (e.g., 70...).
-        int year = 0, retval = LittleYear::get(text, year);
-        if (year < WRAP_)
-          ts.tm_year = year + 2000;
-        else
-          ts.tm_year = year + 1900;
-        return retval;
-        break;
-      }
-    default:
-      throw DateBadFormatElement();
-  } 
-  return 0;
+  AmPm ampm = AMPM_NONE;
+  const unsigned int length = parse_field(fmt, text.data(), text.size(), ts, ampm);
+  if (ampm != AMPM_NONE) {
+    if (ampm == AMPM_PM && ts.tm_hour < 12)
+      ts.tm_hour += 12;
+    else if (ampm == AMPM_AM && ts.tm_hour == 12)
+      ts.tm_hour = 0;
+  }
+  return length;
 }
 
 // function:  parse_ampm
 // params:    text: remaining unparsed date string to be parsed
-//            loc: locale object on this stream.
+//            loc: unused; the formatter's own indicators are used.
 //            ts: POSIX time struct.
 // returns:   integer indicating the number of characters read and parsed.
-// called by: parse_datepart
-// purpose:   reads the string passed into it searching for locale-specific
-//            am/pm indicator.
+// purpose:   reads the locale-specific am/pm indicator at the start of the
+//            string, and moves ts.tm_hour onto the 24-hour clock to match.
 //
 inline
 unsigned int DateFormatter::parse_ampm(const std::string& text, 
-                                       const std::locale& loc, std::tm& ts)
+                                       const std::locale& loc, 
+                                       std::tm& ts) const
 {
-  static std::string am_upper;
-  static std::string am_lower;
-  static std::string pm_upper;
-  static std::string pm_lower;
-  if (am_upper.empty() || pm_upper.empty() || 
-      am_lower.empty() || pm_lower.empty()) {
-    // still need to determine this locale's AM/PM string.
-    TimeStruct temp;
-    std::ostringstream os;
-  
-    // Get the facet that is currently installed on this output stream.
-    std::time_put<char> const& facet = 
-      std::use_facet< std::time_put<char> >( os.getloc() );
-
-    { // upper
-      const char pat[2] = { '%', 'p' };
-      facet.put(os, os, os.fill(), &temp, pat, pat + sizeof(pat));
-      am_upper = os.str();
-      os.str("");
-      temp.tm_hour = 13;
-      facet.put(os, os, os.fill(), &temp, pat, pat + sizeof(pat));
-      pm_upper = os.str();
-      os.str("");
-    }
-    
-    { // lower
-      const char pat[2] = { '%', 'P' };
-      facet.put(os, os, os.fill(), &temp, pat, pat + sizeof(pat));
-      temp.tm_hour = 0;
-      am_lower = os.str();
-      os.str("");
-      temp.tm_hour = 13;
-      facet.put(os, os, os.fill(), &temp, pat, pat + sizeof(pat));
-      pm_lower = os.str();
-      os.str("");      
-    } 
-  }
-
-  if (text.find_first_of(pm_upper) != std::string::npos ||
-      text.find_first_of(pm_lower)) {
-    // we found a PM indicator.  Adjust the hour accordingly if need be.
-    if (ts.tm_hour < 13)
-      ts.tm_hour += 12;
-
-    return pm_upper.size();
-  }
-  
-  // For AM, we don't need to do anything, but we still throw if we *don't*
-  // see it.
-  //
-  if (text.find_first_of(am_upper) == std::string::npos &&
-      text.find_first_of(am_lower) == std::string::npos) {
-    throw DateParsingException();
-  }
-
-  return am_upper.size();
+  return parse_datepart('p', text, loc, ts);
 }
 
 } // namespace dragonfly
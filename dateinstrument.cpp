@@ -0,0 +1,258 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "dateinstrument.h"
+
+#include <ostream>
+#include <string>
+#include <cstring>
+#ifdef DFLY_INSTRUMENT
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#endif
+
+namespace dragonfly {
+namespace instrument {
+
+namespace {
+  const char* const NAMES[COUNTER_COUNT] = {
+    "year_fast_1900", "year_fast_2000", "year_generic",
+    "month_calls", "day_calls", "day_of_year_calls", "day_of_week_calls",
+    "time_struct_calls",
+    "format_calls", "format_bytes", "format_failures",
+    "parse_calls", "parse_failures",
+    "exceptions"
+  };
+  const char* const OPERATIONS[OPERATION_COUNT] = { "format", "parse" };
+}
+
+#ifdef DFLY_INSTRUMENT
+// Not in the anonymous namespace: with DFLY_HEADER_ONLY this file is
+// compiled into every translation unit, and they all have to share one
+// registry and one set of hooks.
+namespace detail {
+  // Every live thread's counters, plus the totals of threads that are gone.
+  struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadCounters*> threads;
+    Snapshot retired;
+    Registry() { std::memset(&retired, 0, sizeof(retired)); }
+  };
+
+  DFLY_INLINE
+  Registry& registry()
+  {
+    static Registry* r = new Registry;  // outlives every thread_local.
+    return *r;
+  }
+
+  DFLY_INLINE
+  void accumulate(Snapshot& total, const ThreadCounters& tc)
+  {
+    for (int c = 0; c < COUNTER_COUNT; ++c)
+      total.counters[c] += tc.counters[c].load(std::memory_order_relaxed);
+    for (int op = 0; op < OPERATION_COUNT; ++op) {
+      for (int b = 0; b < LATENCY_BUCKETS; ++b)
+        total.latency[op][b] += tc.latency[op][b].load(std::memory_order_relaxed);
+      total.latencyNanos[op] +=
+        tc.latencyNanos[op].load(std::memory_order_relaxed);
+    }
+  }
+
+  // Registers a thread's counters on construction, and folds them into the
+  // retired totals when the thread exits.
+  struct Registration {
+    ThreadCounters counters;
+    Registration() {
+      for (int c = 0; c < COUNTER_COUNT; ++c)
+        counters.counters[c].store(0, std::memory_order_relaxed);
+      for (int op = 0; op < OPERATION_COUNT; ++op) {
+        for (int b = 0; b < LATENCY_BUCKETS; ++b)
+          counters.latency[op][b].store(0, std::memory_order_relaxed);
+        counters.latencyNanos[op].store(0, std::memory_order_relaxed);
+      }
+      Registry& r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.threads.push_back(&counters);
+    }
+    ~Registration() {
+      Registry& r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      accumulate(r.retired, counters);
+      r.threads.erase(std::find(r.threads.begin(), r.threads.end(), &counters));
+    }
+  };
+
+  struct Hooks {
+    BeforeHook before;
+    AfterHook after;
+    void* user;
+  };
+  DFLY_INLINE
+  Hooks& hooks()
+  {
+    static Hooks h = { 0, 0, 0 };
+    return h;
+  }
+
+  DFLY_INLINE
+  int bucket(unsigned long long ns)
+  {
+    int b = 0;
+    while (ns >>= 1)
+      ++b;
+    return b < LATENCY_BUCKETS ? b : LATENCY_BUCKETS - 1;
+  }
+}
+using namespace detail;
+#endif
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const bool enabled()
+{
+#ifdef DFLY_INSTRUMENT
+  return true;
+#else
+  return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const char* name(const Counter counter)
+{
+  return (counter >= 0 && counter < COUNTER_COUNT) ? NAMES[counter] : "";
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const Snapshot snapshot()
+{
+  Snapshot total;
+  std::memset(&total, 0, sizeof(total));
+#ifdef DFLY_INSTRUMENT
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  total = r.retired;
+  for (size_t t = 0; t < r.threads.size(); ++t)
+    accumulate(total, *r.threads[t]);
+#endif
+  return total;
+}
+
+//-----------------------------------------------------------------------------
+// Zeroes everything.  Counters being bumped at the same moment on other 
+// threads may survive the reset; it's meant for between test runs.
+//
+DFLY_INLINE
+void reset()
+{
+#ifdef DFLY_INSTRUMENT
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::memset(&r.retired, 0, sizeof(r.retired));
+  for (size_t t = 0; t < r.threads.size(); ++t) {
+    ThreadCounters& tc = *r.threads[t];
+    for (int c = 0; c < COUNTER_COUNT; ++c)
+      tc.counters[c].store(0, std::memory_order_relaxed);
+    for (int op = 0; op < OPERATION_COUNT; ++op) {
+      for (int b = 0; b < LATENCY_BUCKETS; ++b)
+        tc.latency[op][b].store(0, std::memory_order_relaxed);
+      tc.latencyNanos[op].store(0, std::memory_order_relaxed);
+    }
+  }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void setHooks(BeforeHook before, AfterHook after, void* user)
+{
+#ifdef DFLY_INSTRUMENT
+  Hooks& h = hooks();
+  h.before = before;
+  h.after = after;
+  h.user = user;
+#else
+  (void)before; (void)after; (void)user;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void write(std::ostream& os)
+{
+  const Snapshot s = snapshot();
+  for (int c = 0; c < COUNTER_COUNT; ++c)
+    os << "dflydate_" << NAMES[c] << ' ' << s.counters[c] << '\n';
+  // Bucket b's bound is 2^(b+1), but the last bucket also takes everything
+  // slower, so its bound is +Inf.
+  for (int op = 0; op < OPERATION_COUNT; ++op) {
+    const std::string name =
+      std::string("dflydate_") + OPERATIONS[op] + "_latency_ns";
+    os << "# TYPE " << name << " histogram\n";
+    unsigned long long calls = 0;
+    for (int b = 0; b < LATENCY_BUCKETS - 1; ++b) {
+      calls += s.latency[op][b];
+      os << name << "_bucket{le=\"" << (2ULL << b) << "\"} " << calls << '\n';
+    }
+    calls += s.latency[op][LATENCY_BUCKETS - 1];
+    os << name << "_bucket{le=\"+Inf\"} " << calls << '\n'
+       << name << "_sum " << s.latencyNanos[op] << '\n'
+       << name << "_count " << calls << '\n';
+  }
+}
+
+#ifdef DFLY_INSTRUMENT
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+ThreadCounters& local()
+{
+  static thread_local Registration registration;
+  return registration.counters;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void before(const Operation op, const DateFormatter& formatter)
+{
+  const Hooks& h = hooks();
+  if (h.before)
+    h.before(op, formatter, h.user);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void after(const Operation op, const DateFormatter& formatter,
+           const unsigned long long nanoseconds, const bool ok)
+{
+  ThreadCounters& tc = local();
+  add(tc.counters[op == FORMAT ? FORMAT_CALLS : PARSE_CALLS], 1);
+  if (!ok)
+    add(tc.counters[op == FORMAT ? FORMAT_FAILURES : PARSE_FAILURES], 1);
+  add(tc.latency[op][bucket(nanoseconds)], 1);
+  add(tc.latencyNanos[op], nanoseconds);
+  const Hooks& h = hooks();
+  if (h.after)
+    h.after(op, formatter, nanoseconds, ok, h.user);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+Scope::~Scope()
+{
+  const unsigned long long ns =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - begin_).count();
+  after(op_, formatter_, ns, std::uncaught_exceptions() == exceptions_);
+}
+
+#endif // DFLY_INSTRUMENT
+
+} // namespace instrument
+} // namespace dragonfly
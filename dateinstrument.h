@@ -0,0 +1,151 @@
+#ifndef __DATEINSTRUMENT_H__
+#define __DATEINSTRUMENT_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Opt-in counters and hooks on the library's hot paths.  Compile the library
+// *and* the code using it with -DDFLY_INSTRUMENT to turn them on (the
+// Makefile does this with INSTRUMENT=1); otherwise the macros below expand
+// to nothing and snapshot() reports zeros.
+//
+// Counters are kept per thread, in relaxed atomics that only their own
+// thread writes, so counting costs a load and a store and never shares a
+// cache line between threads.  snapshot() adds up every live thread plus
+// whatever threads that have since exited left behind.
+
+#include "datetypes.h"
+#include <iosfwd>
+#ifdef DFLY_INSTRUMENT
+#include <atomic>
+#include <chrono>
+#include <exception>
+#endif
+
+namespace dragonfly {
+
+class DateFormatter;
+
+namespace instrument {
+
+enum Counter {
+  YEAR_FAST_1900,      // Gregorian::year() took the 1900-1999 path
+  YEAR_FAST_2000,      // ... the 2000-2099 path
+  YEAR_GENERIC,        // ... the general path
+  MONTH_CALLS,
+  DAY_CALLS,
+  DAY_OF_YEAR_CALLS,
+  DAY_OF_WEEK_CALLS,
+  TIME_STRUCT_CALLS,
+  FORMAT_CALLS,
+  FORMAT_BYTES,        // characters produced by DateFormatter::format
+  FORMAT_FAILURES,
+  PARSE_CALLS,
+  PARSE_FAILURES,
+  EXCEPTIONS,          // exceptions thrown by the inline code in headers:
+                       // Gregorian, Convert, LocaleParser, Interval,
+                       // unixtime.h and StaticDateFormatter
+  COUNTER_COUNT
+};
+
+enum Operation { FORMAT, PARSE, OPERATION_COUNT };
+
+// Latency bucket b holds calls that took [2^b, 2^(b+1)) nanoseconds;
+// bucket 0 also holds anything under a nanosecond.
+const int LATENCY_BUCKETS = 40;
+
+struct Snapshot {
+  unsigned long long counters[COUNTER_COUNT];
+  unsigned long long latency[OPERATION_COUNT][LATENCY_BUCKETS];
+  unsigned long long latencyNanos[OPERATION_COUNT];    // total time spent
+};
+
+// Hooks run around every DateFormatter::format and parse call.  The after
+// hook gets the call's duration and whether it succeeded (i.e. didn't
+// throw).  Hooks must be thread safe; set them before starting threads.
+typedef void (*BeforeHook)(Operation op, const DateFormatter& formatter,
+                           void* user);
+typedef void (*AfterHook)(Operation op, const DateFormatter& formatter,
+                          unsigned long long nanoseconds, bool ok, void* user);
+
+const bool enabled();
+const char* name(const Counter counter);
+const Snapshot snapshot();
+void reset();
+void setHooks(BeforeHook before, AfterHook after, void* user);
+
+// Writes one "dflydate_<counter> <value>" line per counter, and each
+// operation's latencies as a Prometheus histogram: a "# TYPE" line, a
+// "dflydate_<op>_latency_ns_bucket{le=\"<bound>\"} <count>" line for every
+// bucket's upper bound, counting the calls that took no longer, then
+// le="+Inf", "dflydate_<op>_latency_ns_sum" and "..._count".
+void write(std::ostream& os);
+
+#ifdef DFLY_INSTRUMENT
+
+struct ThreadCounters {
+  std::atomic<unsigned long long> counters[COUNTER_COUNT];
+  std::atomic<unsigned long long> latency[OPERATION_COUNT][LATENCY_BUCKETS];
+  std::atomic<unsigned long long> latencyNanos[OPERATION_COUNT];
+};
+
+// This thread's counters, registered with snapshot() on first use.
+ThreadCounters& local();
+
+inline void add(std::atomic<unsigned long long>& counter,
+                const unsigned long long n)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+inline void count(const Counter counter, const unsigned long long n = 1)
+{ add(local().counters[counter], n); }
+
+void before(const Operation op, const DateFormatter& formatter);
+void after(const Operation op, const DateFormatter& formatter,
+           const unsigned long long nanoseconds, const bool ok);
+
+// class:   Scope
+// purpose: Times a format or parse call and counts it on the way out,
+//          as a failure if it's leaving because of an exception.
+//
+class Scope {
+  public:
+    Scope(const Operation op, const DateFormatter& formatter)
+      : op_(op), formatter_(formatter),
+        exceptions_(std::uncaught_exceptions()),
+        begin_(std::chrono::steady_clock::now())
+    { before(op_, formatter_); }
+    ~Scope();
+    void bytes(const unsigned long long n) { count(FORMAT_BYTES, n); }
+  private:
+    Scope(const Scope&);
+    Scope& operator= (const Scope&);
+  private:
+    const Operation op_;
+    const DateFormatter& formatter_;
+    const int exceptions_;
+    const std::chrono::steady_clock::time_point begin_;
+};
+
+#endif // DFLY_INSTRUMENT
+
+} // namespace instrument
+} // namespace dragonfly
+
+#ifdef DFLY_INSTRUMENT
+#define DFLY_COUNT(counter) \
+  ::dragonfly::instrument::count(::dragonfly::instrument::counter)
+#define DFLY_INSTRUMENT_SCOPE(var, op, formatter) \
+  ::dragonfly::instrument::Scope var(::dragonfly::instrument::op, formatter)
+#define DFLY_INSTRUMENT_BYTES(var, n) var.bytes(n)
+#else
+#define DFLY_COUNT(counter) ((void)0)
+#define DFLY_INSTRUMENT_SCOPE(var, op, formatter) ((void)0)
+#define DFLY_INSTRUMENT_BYTES(var, n) ((void)0)
+#endif
+
+#endif //__DATEINSTRUMENT_H__
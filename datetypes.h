@@ -9,4 +9,18 @@
 typedef int datecount_t;
 typedef int tickcount_t;
 
+// Days and ticks folded into a single, order-preserving count of ticks since
+// epoch.  Used wherever timestamps are stored or compared in bulk.
+typedef long long packedtime_t;
+
+// Goes in front of every function the library defines in a .cpp file.  With
+// DFLY_HEADER_ONLY, dflydate.h pulls those .cpp files in too and they become
+// inline, so a program can build the whole library into itself (and let the
+// compiler inline it) without linking libdflydate.
+#ifdef DFLY_HEADER_ONLY
+#define DFLY_INLINE inline
+#else
+#define DFLY_INLINE
+#endif
+
 #endif //__DATETYPES_H__
@@ -0,0 +1,69 @@
+#ifndef __DFLYDATE_H__
+#define __DFLYDATE_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Includes the whole library.
+//
+// Normally that's all this does, and the program links against libdflydate.
+// Define DFLY_HEADER_ONLY (on the command line, or before every include of
+// this file) and it also pulls in the library's .cpp files, with all of
+// their functions marked inline, so there's nothing to link and the
+// compiler can see -- and inline -- every call.  Every translation unit in
+// the program has to agree on DFLY_HEADER_ONLY, and must not also link
+// libdflydate.
+
+#include "datetypes.h"
+#include "dateexception.h"
+#include "dateinstrument.h"
+#include "epochcounter.h"
+#include "gregorian.h"
+#include "datetime.h"
+#include "duration.h"
+#include "unixtime.h"
+#include "epocharray.h"
+#include "timesort.h"
+#include "timewindow.h"
+#include "timerwheel.h"
+#include "durationformat.h"
+#include "interval.h"
+#include "arrowcolumn.h"
+#include "dateformatter.h"
+#include "staticdateformatter.h"
+#include "timerangefilter.h"
+#include "calendarcursor.h"
+#include "timemerge.h"
+#include "reorderbuffer.h"
+#include "durationhistogram.h"
+#include "stopwatch.h"
+#include "streamingdateparser.h"
+#include "formatsniffer.h"
+#include "formatterregistry.h"
+#include "timecolumn.h"
+
+#ifdef DFLY_HEADER_ONLY
+#include "dateinstrument.cpp"
+#include "dateformatter.cpp"
+#include "streamingdateparser.cpp"
+#include "formatsniffer.cpp"
+#include "formatterregistry.cpp"
+#include "timecolumn.cpp"
+#include "epocharray.cpp"
+#include "timesort.cpp"
+#include "timewindow.cpp"
+#include "timerwheel.cpp"
+#include "durationformat.cpp"
+#include "interval.cpp"
+#include "arrowcolumn.cpp"
+#include "timerangefilter.cpp"
+#include "calendarcursor.cpp"
+#include "timemerge.cpp"
+#include "reorderbuffer.cpp"
+#include "durationhistogram.cpp"
+#include "stopwatch.cpp"
+#endif
+
+#endif //__DFLYDATE_H__
@@ -0,0 +1,319 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "durationformat.h"
+
+#include <climits>
+#include <cstring>
+
+namespace dragonfly {
+
+namespace {
+  typedef unsigned long long ticks_t;
+
+  const ticks_t MS_SECOND = EpochCounter::TICKS_PER_SECOND;
+  const ticks_t MS_MINUTE = EpochCounter::TICKS_PER_MINUTE;
+  const ticks_t MS_HOUR = EpochCounter::TICKS_PER_HOUR;
+  const ticks_t MS_DAY = EpochCounter::TICKS_PER_DAY;
+  const ticks_t MS_WEEK = MS_DAY * 7;
+
+  // The longest Duration whose days still fit in a datecount_t.
+  const ticks_t MAX_TICKS = static_cast<ticks_t>(INT_MAX) * MS_DAY;
+
+  // Anything longer than this many digits can't be a valid duration.
+  const int MAX_DIGITS = 18;
+
+  // Fraction digits past this are ignored; they're well under a tick.
+  const int MAX_FRACTION_DIGITS = 9;
+
+  // class:   TextBuffer
+  // purpose: Appends to a fixed-size scratch buffer that's big enough for
+  //          any duration, so the appends needn't check.
+  //
+  struct TextBuffer {
+    char text[48];
+    size_t length;
+
+    TextBuffer() : length(0) {}
+    void put(const char c) { text[length++] = c; }
+    void put(const char* s) { while (*s) put(*s++); }
+    void number(ticks_t v, const int width = 1)
+    {
+      char digits[24];
+      int n = 0;
+      do {
+        digits[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+      } while (v || n < width);
+      while (n) put(digits[--n]);
+    }
+    size_t copy(char* out, const size_t size) const
+    {
+      if (length + 1 > size)
+        return 0;
+      std::memcpy(out, text, length);
+      out[length] = '\0';
+      return length;
+    }
+  };
+
+  // struct:  DurationNumber
+  // purpose: A number as read from a duration: whole part, and the
+  //          fraction as frac / scale.
+  //
+  struct DurationNumber {
+    ticks_t whole;
+    ticks_t frac;
+    ticks_t scale;
+  };
+
+  // function:  readNumber
+  // params:    commas: whether ',' can start a fraction, as in ISO 8601
+  // returns:   the characters read, or 0 if there's no number at p.
+  //
+  size_t readNumber(const char* p, const char* end, const bool commas,
+                    DurationNumber& n)
+  {
+    const char* start = p;
+    n.whole = 0;
+    n.frac = 0;
+    n.scale = 1;
+    int digits = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+      if (++digits > MAX_DIGITS)
+        return 0;
+      n.whole = n.whole * 10 + (*p++ - '0');
+    }
+    if (digits == 0)
+      return 0;
+    if (p + 1 < end && (*p == '.' || (commas && *p == ',')) &&
+        p[1] >= '0' && p[1] <= '9') {
+      ++p;
+      int places = 0;
+      while (p < end && *p >= '0' && *p <= '9') {
+        if (places++ < MAX_FRACTION_DIGITS) {
+          n.frac = n.frac * 10 + (*p - '0');
+          n.scale *= 10;
+        }
+        ++p;
+      }
+    }
+    return p - start;
+  }
+
+  // function:  accumulate
+  // purpose:   total += n units, checking for overflow.
+  //
+  bool accumulate(ticks_t& total, const DurationNumber& n, const ticks_t unit)
+  {
+    if (n.whole > (MAX_TICKS - total) / unit)
+      return false;
+    total += n.whole * unit;
+    const ticks_t part = n.frac * unit / n.scale;  // < unit; can't overflow
+    if (part > MAX_TICKS - total)
+      return false;
+    total += part;
+    return true;
+  }
+
+  void setDuration(Duration& duration, const bool negative, const ticks_t total)
+  {
+    EpochCounter counter;
+    const packedtime_t signedTotal = static_cast<packedtime_t>(total);
+    counter.packed(negative ? -signedTotal : signedTotal);
+    duration = counter;
+  }
+
+  // function:  splitDuration
+  // purpose:   The duration's magnitude and sign.
+  //
+  const ticks_t splitDuration(const Duration& duration, bool& negative)
+  {
+    const packedtime_t total = duration.packed();
+    negative = total < 0;
+    return negative ? 0 - static_cast<ticks_t>(total)
+                    : static_cast<ticks_t>(total);
+  }
+
+  //---------------------------------------------------------------------------
+  size_t formatIso(const Duration& duration, char* out, const size_t size)
+  {
+    bool negative;
+    const ticks_t total = splitDuration(duration, negative);
+    const ticks_t days = total / MS_DAY, rest = total % MS_DAY;
+    const ticks_t hours = rest / MS_HOUR, minutes = rest / MS_MINUTE % 60;
+    const ticks_t seconds = rest / MS_SECOND % 60, millis = rest % MS_SECOND;
+
+    TextBuffer b;
+    if (negative) b.put('-');
+    b.put('P');
+    if (days) { b.number(days); b.put('D'); }
+    if (rest || !days) {
+      b.put('T');
+      if (hours) { b.number(hours); b.put('H'); }
+      if (minutes) { b.number(minutes); b.put('M'); }
+      if (seconds || millis || !rest) {
+        b.number(seconds);
+        if (millis) { b.put('.'); b.number(millis, 3); }
+        b.put('S');
+      }
+    }
+    return b.copy(out, size);
+  }
+
+  //---------------------------------------------------------------------------
+  size_t formatCompact(const Duration& duration, char* out, const size_t size)
+  {
+    bool negative;
+    const ticks_t total = splitDuration(duration, negative);
+    const ticks_t days = total / MS_DAY, rest = total % MS_DAY;
+
+    TextBuffer b;
+    if (negative) b.put('-');
+    if (days) { b.number(days); b.put('d'); }
+    if (rest / MS_HOUR) { b.number(rest / MS_HOUR); b.put('h'); }
+    if (rest / MS_MINUTE % 60) { b.number(rest / MS_MINUTE % 60); b.put('m'); }
+    if (rest / MS_SECOND % 60) { b.number(rest / MS_SECOND % 60); b.put('s'); }
+    if (rest % MS_SECOND) { b.number(rest % MS_SECOND); b.put("ms"); }
+    if (!total) b.put("0s");
+    return b.copy(out, size);
+  }
+
+  //---------------------------------------------------------------------------
+  // Components must come in this order, each at most once, and only the
+  // last may have a fraction.
+  //
+  size_t parseIso(const char* text, const size_t length, Duration& duration)
+  {
+    const char* p = text;
+    const char* end = text + length;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+      negative = (*p++ == '-');
+    if (p == end || *p++ != 'P')
+      return 0;
+
+    enum { WEEKS, DAYS, HOURS, MINUTES, SECONDS };
+    const ticks_t units[] = { MS_WEEK, MS_DAY, MS_HOUR, MS_MINUTE, MS_SECOND };
+    ticks_t total = 0;
+    int next = WEEKS;          // lowest component still allowed
+    bool time = false, any = false, fraction = false;
+    const char* good = 0;      // end of the last complete component
+
+    while (p < end && !fraction) {
+      if (*p == 'T' && !time) {
+        time = true;
+        next = HOURS;
+        ++p;
+        continue;
+      }
+      DurationNumber n;
+      const size_t read = readNumber(p, end, true, n);
+      if (read == 0 || p + read == end)
+        break;
+      int unit;
+      switch (p[read]) {
+        case 'W': unit = time ? -1 : WEEKS; break;
+        case 'D': unit = time ? -1 : DAYS; break;
+        case 'H': unit = time ? HOURS : -1; break;
+        case 'M': unit = time ? MINUTES : -1; break;  // months aren't fixed
+        case 'S': unit = time ? SECONDS : -1; break;
+        default: unit = -1;
+      }
+      if (unit < next)
+        break;
+      if (!accumulate(total, n, units[unit]))
+        return 0;
+      next = unit + 1;
+      fraction = n.scale > 1;
+      any = true;
+      p += read + 1;
+      good = p;
+    }
+
+    // A 'T' has to be followed by something.
+    if (!any || (time && next == HOURS))
+      return 0;
+    setDuration(duration, negative, total);
+    return good - text;
+  }
+
+  //---------------------------------------------------------------------------
+  size_t parseCompact(const char* text, const size_t length, Duration& duration)
+  {
+    const char* p = text;
+    const char* end = text + length;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+      negative = (*p++ == '-');
+
+    ticks_t total = 0;
+    bool any = false;
+    const char* good = 0;
+    while (p < end) {
+      DurationNumber n;
+      const size_t read = readNumber(p, end, false, n);
+      if (read == 0)
+        break;
+      const char* u = p + read;
+      ticks_t unit = 0;
+      size_t unitLength = 1;
+      if (u < end) {
+        switch (*u) {
+          case 'w': unit = MS_WEEK; break;
+          case 'd': unit = MS_DAY; break;
+          case 'h': unit = MS_HOUR; break;
+          case 's': unit = MS_SECOND; break;
+          case 'm':
+            if (u + 1 < end && u[1] == 's') {
+              unit = 1;
+              unitLength = 2;
+            }
+            else
+              unit = MS_MINUTE;
+            break;
+        }
+      }
+      if (!unit) {
+        // A lone zero needs no unit.
+        if (!any && n.whole == 0 && n.scale == 1) {
+          any = true;
+          good = u;
+        }
+        break;
+      }
+      if (!accumulate(total, n, unit))
+        return 0;
+      any = true;
+      p = u + unitLength;
+      good = p;
+    }
+
+    if (!any)
+      return 0;
+    setDuration(duration, negative, total);
+    return good - text;
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+size_t formatDuration(const Duration& duration, char* out, const size_t size,
+                      const DurationStyle style)
+{
+  return style == DURATION_COMPACT ? formatCompact(duration, out, size)
+                                   : formatIso(duration, out, size);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+size_t parseDuration(const char* text, const size_t length, Duration& duration,
+                     const DurationStyle style)
+{
+  return style == DURATION_COMPACT ? parseCompact(text, length, duration)
+                                   : parseIso(text, length, duration);
+}
+
+} // namespace dragonfly
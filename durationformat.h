@@ -0,0 +1,55 @@
+#ifndef __DURATIONFORMAT_H__
+#define __DURATIONFORMAT_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Text forms of a Duration, written into and read from caller-supplied
+// buffers.  Nothing here allocates or throws; failures come back as a
+// return value of 0.
+//
+// DURATION_ISO8601 is the ISO 8601 duration format: P2DT3H, PT1H30M,
+// PT0.250S, and PT0S for nothing at all.  Durations have no notion of
+// months or years, so those are never written, and are rejected when
+// parsing (a month isn't a fixed length of time).  Weeks (P2W) are read but
+// written out as days.  A fraction is allowed on the last component,
+// with '.' or ',', and a leading '-' makes the duration negative.
+//
+// DURATION_COMPACT is the short form used in log lines: 1h30m, 250ms,
+// 2d3h, 1m30s500ms, 0s.  Parsing also takes weeks (w), fractions (1.5h),
+// any order, and a bare 0.
+//
+// Durations are counted in milliseconds; finer fractions are dropped.
+
+#include "duration.h"
+#include <cstddef>
+
+namespace dragonfly {
+
+enum DurationStyle {
+  DURATION_ISO8601,
+  DURATION_COMPACT
+};
+
+// function:  formatDuration
+// params:    out, size: the buffer, which gets a terminating NUL
+// returns:   the length of the text, or 0 if it (plus the NUL) doesn't fit.
+//            40 characters is always enough.
+//
+size_t formatDuration(const Duration& duration, char* out, const size_t size,
+                      const DurationStyle style = DURATION_ISO8601);
+
+// function:  parseDuration
+// params:    text, length: need not be NUL terminated
+//            duration: set only on success
+// returns:   the number of characters making up the duration at the start
+//            of text, or 0 if it doesn't start with a valid one.
+//
+size_t parseDuration(const char* text, const size_t length, Duration& duration,
+                     const DurationStyle style = DURATION_ISO8601);
+
+} // namespace dragonfly
+
+#endif //__DURATIONFORMAT_H__
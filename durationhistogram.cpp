@@ -0,0 +1,243 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "durationhistogram.h"
+
+#include <cstring>
+
+namespace dragonfly {
+
+namespace {
+  const char HISTOGRAM_MAGIC[4] = { 'D','F','H','1' };
+  const uint64_t NANOS_PER_TICK = 1000000;
+
+  void putVarint(std::string& out, uint64_t v)
+  {
+    while (v >= 0x80) {
+      out += static_cast<char>(v | 0x80);
+      v >>= 7;
+    }
+    out += static_cast<char>(v);
+  }
+
+  // Throws DateColumnException at the end of the data or on a varint that
+  // runs past 64 bits.
+  uint64_t getVarint(const unsigned char*& p, const unsigned char* end)
+  {
+    uint64_t v = 0;
+    unsigned int shift = 0;
+    do {
+      if (p == end || shift > 63) throw DateColumnException();
+      v |= static_cast<uint64_t>(*p & 0x7f) << shift;
+      shift += 7;
+    } while (*p++ & 0x80);
+    return v;
+  }
+
+  const Duration nanosToDuration(const uint64_t nanoseconds)
+  {
+    EpochCounter ticks;
+    ticks.packed(static_cast<packedtime_t>(nanoseconds / NANOS_PER_TICK));
+    return Duration(ticks);
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+DurationHistogram::DurationHistogram(const Duration& highest,
+                                     const int precision)
+  : precision_(precision), highest_(0), total_(0), min_(~0ull), max_(0)
+{
+  const packedtime_t ticks = highest.packed();
+  if (precision < 1 || precision > 14 || ticks <= 0 ||
+      static_cast<uint64_t>(ticks) > ~0ull / NANOS_PER_TICK)
+    throw DateValueOutOfRangeException();
+  highest_ = static_cast<uint64_t>(ticks) * NANOS_PER_TICK;
+  counts_.assign(bucketOf(highest_) + 1, 0);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void DurationHistogram::merge(const DurationHistogram& other)
+{
+  if (other.precision_ != precision_ || other.highest_ != highest_)
+    throw DateValueOutOfRangeException();
+  uint64_t* into = &counts_[0];
+  const uint64_t* from = &other.counts_[0];
+  for (size_t i = 0; i < counts_.size(); ++i)
+    into[i] += from[i];
+  total_ += other.total_;
+  min_ = other.min_ < min_ ? other.min_ : min_;
+  max_ = other.max_ > max_ ? other.max_ : max_;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void DurationHistogram::reset()
+{
+  counts_.assign(counts_.size(), 0);
+  total_ = 0;
+  min_ = ~0ull;
+  max_ = 0;
+}
+
+// function:  bucketLow
+// purpose:   Inverts bucketOf.  Buckets [0, 2^(precision+1)) hold one value
+//            each; after that every 2^precision buckets are twice as wide
+//            as the ones before.
+//
+DFLY_INLINE
+const uint64_t DurationHistogram::bucketLow(const size_t bucket) const
+{
+  const size_t group = bucket >> precision_;
+  const int shift = group > 1 ? static_cast<int>(group - 1) : 0;
+  return static_cast<uint64_t>(bucket - (static_cast<size_t>(shift) << precision_))
+         << shift;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const uint64_t DurationHistogram::bucketHigh(const size_t bucket) const
+{
+  const size_t group = bucket >> precision_;
+  const int shift = group > 1 ? static_cast<int>(group - 1) : 0;
+  return bucketLow(bucket) + ((static_cast<uint64_t>(1) << shift) - 1);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const uint64_t DurationHistogram::percentileNanos(const double percent) const
+{
+  if (!total_)
+    return 0;
+  if (percent <= 0.0)
+    return min_;
+  // The rank of the value wanted, 1-based.
+  double wanted = percent / 100.0 * static_cast<double>(total_);
+  uint64_t rank = static_cast<uint64_t>(wanted);
+  if (static_cast<double>(rank) < wanted)
+    ++rank;
+  if (rank < 1)
+    rank = 1;
+  if (rank >= total_)
+    return max_;
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      const uint64_t high = bucketHigh(i);
+      return high < max_ ? (high > min_ ? high : min_) : max_;
+    }
+  }
+  return max_;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const double DurationHistogram::meanNanos() const
+{
+  if (!total_)
+    return 0.0;
+  double sum = 0.0;
+  for (size_t i = 0; i < counts_.size(); ++i)
+    if (counts_[i])
+      sum += static_cast<double>(counts_[i]) *
+             (static_cast<double>(bucketLow(i)) +
+              static_cast<double>(bucketHigh(i))) / 2.0;
+  return sum / static_cast<double>(total_);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const Duration DurationHistogram::percentile(const double percent) const
+{
+  return nanosToDuration(percentileNanos(percent));
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const Duration DurationHistogram::mean() const
+{
+  return nanosToDuration(static_cast<uint64_t>(meanNanos()));
+}
+
+// function:  write
+// purpose:   Appends "DFH1", then as varints: precision, highest, count,
+//            min, max, and the counts up to the last non-empty bucket.
+//            A count c is written as 2c, a run of n empty buckets as 2n+1.
+//
+DFLY_INLINE
+void DurationHistogram::write(std::string& out) const
+{
+  out.append(HISTOGRAM_MAGIC, sizeof(HISTOGRAM_MAGIC));
+  putVarint(out, static_cast<uint64_t>(precision_));
+  putVarint(out, highest_ / NANOS_PER_TICK);
+  putVarint(out, total_);
+  putVarint(out, minNanos());
+  putVarint(out, max_);
+
+  size_t used = counts_.size();
+  while (used && !counts_[used - 1])
+    --used;
+  for (size_t i = 0; i < used; ) {
+    if (counts_[i]) {
+      putVarint(out, counts_[i] << 1);
+      ++i;
+      continue;
+    }
+    size_t run = 1;
+    while (!counts_[i + run])
+      ++run;
+    putVarint(out, static_cast<uint64_t>(run) << 1 | 1);
+    i += run;
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const DurationHistogram DurationHistogram::read(const void* data,
+                                                const size_t size)
+{
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const unsigned char* end = p + size;
+  if (size < sizeof(HISTOGRAM_MAGIC) ||
+      std::memcmp(p, HISTOGRAM_MAGIC, sizeof(HISTOGRAM_MAGIC)))
+    throw DateColumnException();
+  p += sizeof(HISTOGRAM_MAGIC);
+
+  const uint64_t precision = getVarint(p, end);
+  const uint64_t highest = getVarint(p, end);
+  if (precision < 1 || precision > 14 || highest == 0 ||
+      highest > ~0ull / NANOS_PER_TICK)
+    throw DateColumnException();
+  EpochCounter ticks;
+  ticks.packed(static_cast<packedtime_t>(highest));
+  DurationHistogram h(Duration(ticks), static_cast<int>(precision));
+
+  const uint64_t total = getVarint(p, end);
+  const uint64_t min = getVarint(p, end);
+  const uint64_t max = getVarint(p, end);
+  uint64_t counted = 0;
+  for (size_t i = 0; p != end; ) {
+    const uint64_t v = getVarint(p, end);
+    const uint64_t n = v & 1 ? v >> 1 : 1;
+    if (n > h.counts_.size() - i)
+      throw DateColumnException();
+    if (!(v & 1)) {
+      h.counts_[i] = v >> 1;
+      counted += v >> 1;
+    }
+    i += static_cast<size_t>(n);
+  }
+  if (counted != total || min > max || max > h.highest_)
+    throw DateColumnException();
+  h.total_ = total;
+  h.min_ = total ? min : ~0ull;
+  h.max_ = max;
+  return h;
+}
+
+} // namespace dragonfly
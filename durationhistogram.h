@@ -0,0 +1,136 @@
+#ifndef __DURATIONHISTOGRAM_H__
+#define __DURATIONHISTOGRAM_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "duration.h"
+#include "datetypes.h"
+#include "dateexception.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace dragonfly {
+
+// class:   DurationHistogram
+// purpose: Percentiles of a great many Durations (latencies, mostly) in a
+//          fixed amount of memory, to within a chosen relative error.
+//
+//          Values are kept in nanoseconds, so latencies too short for a
+//          Duration's millisecond ticks can be recorded with recordNanos().
+//          Buckets are log-linear: each power of two is split into
+//          2^precision equal buckets, so a value's bucket is at most
+//          2^-precision of the value wide (under 1% for the default of 7),
+//          and everything below 2^(precision + 1) nanoseconds is exact.
+//          Recording is a bit scan, a shift and an increment; the buckets
+//          are allocated once, up front, to cover values up to highest.
+//          Anything higher is counted as highest.
+//
+//          Not thread safe.  Keep one per thread and merge() them for a
+//          report: merging is adding two arrays.
+//
+class DurationHistogram {
+  public:
+    // precision: 1 to 14 bits.  Throws DateValueOutOfRangeException if
+    // it's out of range or highest isn't positive.
+    explicit DurationHistogram(const Duration& highest = Weeks(1),
+                               const int precision = 7);
+
+  public:
+    // Negative durations count as 0.
+    void record(const Duration& value, const uint64_t count = 1);
+    void recordNanos(uint64_t nanoseconds, const uint64_t count = 1);
+
+    // Adds other's counts to this one's.  Throws
+    // DateValueOutOfRangeException unless both were made with the same
+    // highest and precision.
+    void merge(const DurationHistogram& other);
+    void reset();
+
+  public:
+    const uint64_t count() const { return total_; }
+    // Exact; 0 if nothing's been recorded.
+    const uint64_t minNanos() const { return total_ ? min_ : 0; }
+    const uint64_t maxNanos() const { return max_; }
+    // The value at or below which percent (0 to 100) of the recorded
+    // values fall: the top of the bucket that percentile lands in, but
+    // never past the largest value recorded.  0 if nothing's been recorded.
+    const uint64_t percentileNanos(const double percent) const;
+    // Taken from the buckets' midpoints, so within the same error.
+    const double meanNanos() const;
+
+    // The same, as Durations, rounded down to a whole millisecond tick.
+    const Duration percentile(const double percent) const;
+    const Duration mean() const;
+
+  public:
+    // A compact encoding for shipping to a collector: varints, with runs
+    // of empty buckets collapsed.  read() throws DateColumnException if
+    // the data isn't one.
+    void write(std::string& out) const;
+    static const DurationHistogram read(const void* data, const size_t size);
+
+  public:
+    const int precision() const { return precision_; }
+    const uint64_t highestNanos() const { return highest_; }
+    // Bytes of bucket counts.
+    const size_t footprint() const
+    { return counts_.size() * sizeof(uint64_t); }
+
+  private:
+    // Which bucket a value falls in: the top precision + 1 bits of it,
+    // plus how far those had to be shifted down.
+    const size_t bucketOf(const uint64_t v) const;
+    const uint64_t bucketLow(const size_t bucket) const;
+    const uint64_t bucketHigh(const size_t bucket) const;
+
+  private:
+    int precision_;
+    uint64_t highest_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t min_;
+    uint64_t max_;
+};
+
+//-----------------------------------------------------------------------------
+inline const size_t DurationHistogram::bucketOf(const uint64_t v) const
+{
+  const int top = 63 - __builtin_clzll(v | 1);
+  const int shift = top > precision_ ? top - precision_ : 0;
+  return (static_cast<size_t>(shift) << precision_) +
+         static_cast<size_t>(v >> shift);
+}
+
+//-----------------------------------------------------------------------------
+inline void DurationHistogram::recordNanos(uint64_t nanoseconds,
+                                           const uint64_t count)
+{
+  if (nanoseconds > highest_)
+    nanoseconds = highest_;
+  counts_[bucketOf(nanoseconds)] += count;
+  total_ += count;
+  min_ = nanoseconds < min_ ? nanoseconds : min_;
+  max_ = nanoseconds > max_ ? nanoseconds : max_;
+}
+
+//-----------------------------------------------------------------------------
+inline void DurationHistogram::record(const Duration& value,
+                                      const uint64_t count)
+{
+  const packedtime_t ticks = value.packed();
+  if (ticks <= 0)
+    recordNanos(0, count);
+  else if (static_cast<uint64_t>(ticks) > highest_ / 1000000)
+    recordNanos(highest_, count);
+  else
+    recordNanos(static_cast<uint64_t>(ticks) * 1000000, count);
+}
+
+} // namespace dragonfly
+
+#endif //__DURATIONHISTOGRAM_H__
@@ -0,0 +1,198 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "epocharray.h"
+#include "unixtime.h"
+
+// The kernels below get compiled once per entry and the dynamic loader
+// picks the best one for the CPU the first time they're called.  x86-64-v4
+// is what brings in AVX-512DQ's 64-bit multiplies and int64<->double
+// conversions; AVX2 still vectorizes the clamping and the multiplies.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) && \
+    defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define DFLY_SIMD_CLONES \
+  __attribute__((target_clones("arch=x86-64-v4", "avx2", "default")))
+#endif
+#endif
+#ifndef DFLY_SIMD_CLONES
+#define DFLY_SIMD_CLONES
+#endif
+
+#if defined(__GNUC__)
+#define DFLY_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define DFLY_ALWAYS_INLINE inline
+#endif
+
+namespace dragonfly {
+
+namespace {
+  // Range of packed values a DateTime can hold.
+  const packedtime_t MIN_PACKED =
+    static_cast<packedtime_t>(INT_MIN) * EpochCounter::TICKS_PER_DAY;
+  const packedtime_t MAX_PACKED =
+    static_cast<packedtime_t>(INT_MAX) * EpochCounter::TICKS_PER_DAY
+    + (EpochCounter::TICKS_PER_DAY - 1);
+
+  // DateTimes are converted through a buffer of packed values this long.
+  const size_t BLOCK = 256;
+
+  DFLY_ALWAYS_INLINE int64_t clamp(const int64_t x, const int64_t lo,
+                                   const int64_t hi)
+  { return x < lo ? lo : (x > hi ? hi : x); }
+
+  // x - q * D, worked out modulo 2^64.  q * D itself can overflow an
+  // int64 when x is near either end, but the remainder it's used for is
+  // small, so the wrapped result is exact.
+  template <int64_t D>
+  DFLY_ALWAYS_INLINE int64_t wrappedRemainder(const int64_t x, const int64_t q)
+  {
+    return static_cast<int64_t>(static_cast<uint64_t>(x) -
+                                static_cast<uint64_t>(q) *
+                                static_cast<uint64_t>(D));
+  }
+
+  // function:  floordiv
+  // purpose:   x / D rounded down.  Integer division doesn't vectorize, so
+  //            this estimates the quotient in double precision and corrects
+  //            it.  The first estimate can be off by a few when the quotient
+  //            is past 2^53; the second works on a small remainder, so it
+  //            leaves the remainder within (-D, D), and the last step fixes
+  //            the sign.  (std::floor would keep GCC from vectorizing.)
+  //
+  template <int64_t D>
+  DFLY_ALWAYS_INLINE int64_t floordiv(const int64_t x)
+  {
+    const double inv = 1.0 / D;
+    int64_t q = static_cast<int64_t>(static_cast<double>(x) * inv);
+    int64_t r = wrappedRemainder<D>(x, q);
+    q += static_cast<int64_t>(static_cast<double>(r) * inv);
+    r = wrappedRemainder<D>(x, q);
+    q += (r >= D);
+    q -= (r < 0);
+    return q;
+  }
+
+  // function:  fromLoop
+  // params:    MUL: Unix units per millisecond coarser than that (seconds),
+  //            DIV: Unix units per millisecond finer than that (micro/nano)
+  //
+  template <int64_t MUL, int64_t DIV>
+  DFLY_ALWAYS_INLINE size_t fromLoop(const int64_t* in, const size_t n,
+                                     packedtime_t* out, unsigned char* overflow)
+  {
+    const int64_t lo = MIN_UNIX_MILLIS / MUL, hi = MAX_UNIX_MILLIS / MUL;
+    size_t bad = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const int64_t x = (DIV > 1) ? floordiv<DIV>(in[i]) : in[i];
+      const bool over = x < lo || x > hi;
+      out[i] = clamp(x, lo, hi) * MUL + UNIX_EPOCH_TICKS;
+      bad += over;
+      if (overflow)
+        overflow[i] = over;
+    }
+    return bad;
+  }
+
+  // function:  toLoop
+  // params:    MUL: Unix units per millisecond (1 for seconds and millis)
+  //            DIV: milliseconds per Unix unit (1000 for seconds, else 1)
+  //
+  template <int64_t MUL, int64_t DIV>
+  DFLY_ALWAYS_INLINE size_t toLoop(const packedtime_t* in, const size_t n,
+                                   int64_t* out, unsigned char* overflow)
+  {
+    const int64_t lo = INT64_MIN / MUL, hi = INT64_MAX / MUL;
+    size_t bad = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const int64_t p = clamp(in[i], MIN_PACKED, MAX_PACKED);
+      const int64_t ms = p - UNIX_EPOCH_TICKS;
+      const int64_t x = (DIV > 1) ? floordiv<DIV>(ms) : ms;
+      const bool over = p != in[i] || x < lo || x > hi;
+      out[i] = clamp(x, lo, hi) * MUL;
+      bad += over;
+      if (overflow)
+        overflow[i] = over;
+    }
+    return bad;
+  }
+
+  DFLY_SIMD_CLONES
+  size_t fromKernel(const int64_t* in, const size_t n, const EpochUnit unit,
+                    packedtime_t* out, unsigned char* overflow)
+  {
+    switch (unit) {
+      case EPOCH_SECONDS: return fromLoop<1000, 1>(in, n, out, overflow);
+      case EPOCH_MILLIS:  return fromLoop<1, 1>(in, n, out, overflow);
+      case EPOCH_MICROS:  return fromLoop<1, 1000>(in, n, out, overflow);
+      case EPOCH_NANOS:   return fromLoop<1, 1000000>(in, n, out, overflow);
+    }
+    return 0;
+  }
+
+  DFLY_SIMD_CLONES
+  size_t toKernel(const packedtime_t* in, const size_t n, const EpochUnit unit,
+                  int64_t* out, unsigned char* overflow)
+  {
+    switch (unit) {
+      case EPOCH_SECONDS: return toLoop<1, 1000>(in, n, out, overflow);
+      case EPOCH_MILLIS:  return toLoop<1, 1>(in, n, out, overflow);
+      case EPOCH_MICROS:  return toLoop<1000, 1>(in, n, out, overflow);
+      case EPOCH_NANOS:   return toLoop<1000000, 1>(in, n, out, overflow);
+    }
+    return 0;
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+size_t fromUnixEpoch(const int64_t* in, const size_t n, const EpochUnit unit,
+                     packedtime_t* out, unsigned char* overflow)
+{
+  return fromKernel(in, n, unit, out, overflow);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+size_t fromUnixEpoch(const int64_t* in, const size_t n, const EpochUnit unit,
+                     DateTime* out, unsigned char* overflow)
+{
+  packedtime_t packed[BLOCK];
+  size_t bad = 0;
+  for (size_t i = 0; i < n; i += BLOCK) {
+    const size_t m = (n - i < BLOCK) ? n - i : BLOCK;
+    bad += fromKernel(in + i, m, unit, packed, overflow ? overflow + i : 0);
+    for (size_t j = 0; j < m; ++j)
+      out[i + j].packed(packed[j]);
+  }
+  return bad;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+size_t toUnixEpoch(const packedtime_t* in, const size_t n, const EpochUnit unit,
+                   int64_t* out, unsigned char* overflow)
+{
+  return toKernel(in, n, unit, out, overflow);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+size_t toUnixEpoch(const DateTime* in, const size_t n, const EpochUnit unit,
+                   int64_t* out, unsigned char* overflow)
+{
+  packedtime_t packed[BLOCK];
+  size_t bad = 0;
+  for (size_t i = 0; i < n; i += BLOCK) {
+    const size_t m = (n - i < BLOCK) ? n - i : BLOCK;
+    for (size_t j = 0; j < m; ++j)
+      packed[j] = in[i + j].packed();
+    bad += toKernel(packed, m, unit, out + i, overflow ? overflow + i : 0);
+  }
+  return bad;
+}
+
+} // namespace dragonfly
@@ -0,0 +1,57 @@
+#ifndef __EPOCHARRAY_H__
+#define __EPOCHARRAY_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Batch conversions between arrays of Unix epoch timestamps (int64 seconds,
+// milliseconds, microseconds or nanoseconds since 1970, as found in most
+// storage and wire formats) and the library's packed timestamps (see
+// EpochCounter::packed) or DateTimes.
+//
+// The packed versions are straight loops over plain integers.  With GCC on
+// x86-64 they're compiled for AVX-512 and AVX2 as well as the baseline, and
+// the best one for the CPU is picked at load time.  With AVX-512 every
+// conversion handles several elements per instruction.  The ones that
+// divide (microseconds and nanoseconds in, seconds out) go through double
+// precision to do it, which AVX2 can't do for int64s, so under AVX2 only
+// the others do.  The DateTime versions go through the packed ones a block
+// at a time.
+//
+// Each call returns how many elements didn't fit: a Unix time outside
+// DateTime's range (see unixtime.h) on the way in, or a DateTime that can't
+// be expressed in the chosen unit as an int64 on the way out -- nanoseconds
+// only reach about 292 years either side of 1970.  Those elements are
+// clamped to the nearest value that does fit, and if an overflow array is
+// passed, flagged there with a 1 (everything else gets a 0).  Conversions
+// to a coarser unit round down, towards the past.
+
+#include "datetime.h"
+#include "datetypes.h"
+#include <cstddef>
+#include <stdint.h>
+
+namespace dragonfly {
+
+enum EpochUnit {
+  EPOCH_SECONDS,
+  EPOCH_MILLIS,
+  EPOCH_MICROS,
+  EPOCH_NANOS
+};
+
+size_t fromUnixEpoch(const int64_t* in, const size_t n, const EpochUnit unit,
+                     packedtime_t* out, unsigned char* overflow = 0);
+size_t fromUnixEpoch(const int64_t* in, const size_t n, const EpochUnit unit,
+                     DateTime* out, unsigned char* overflow = 0);
+
+size_t toUnixEpoch(const packedtime_t* in, const size_t n, const EpochUnit unit,
+                   int64_t* out, unsigned char* overflow = 0);
+size_t toUnixEpoch(const DateTime* in, const size_t n, const EpochUnit unit,
+                   int64_t* out, unsigned char* overflow = 0);
+
+} // namespace dragonfly
+
+#endif //__EPOCHARRAY_H__
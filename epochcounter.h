@@ -28,12 +28,13 @@ class EpochCounter {
     const bool operator>= (const EpochCounter& other);
 
   public:
-    static const tickcount_t TICKS_PER_SECOND; 
-    static const tickcount_t TICKS_PER_MINUTE;
-    static const tickcount_t TICKS_PER_HOUR;
-    static const tickcount_t TICKS_PER_DAY;
-    static const tickcount_t TICKS_PER_WEEK;
-    static const datecount_t DAYS_PER_WEEK;
+    // Defined here rather than in a .cpp so callers can fold them.
+    static constexpr tickcount_t TICKS_PER_SECOND = 1000;
+    static constexpr tickcount_t TICKS_PER_MINUTE = TICKS_PER_SECOND * 60;
+    static constexpr tickcount_t TICKS_PER_HOUR = TICKS_PER_MINUTE * 60;
+    static constexpr tickcount_t TICKS_PER_DAY = TICKS_PER_HOUR * 24;
+    static constexpr tickcount_t TICKS_PER_WEEK = TICKS_PER_DAY * 7;
+    static constexpr datecount_t DAYS_PER_WEEK = 7;
     
   public: 
     void operator-= (const EpochCounter& other);
@@ -44,6 +45,8 @@ class EpochCounter {
     void days(const datecount_t& days) { m_days = days; }
     const tickcount_t& ticks() const { return m_ticks; }
     void ticks(const tickcount_t& ticks) { m_ticks = ticks; }
+    const packedtime_t packed() const;
+    void packed(const packedtime_t& packed);
  
   private:
     datecount_t m_days;
@@ -71,6 +74,26 @@ inline const bool EpochCounter::operator>= (const EpochCounter& other)
     m_ticks >= other.m_ticks : m_days >= other.m_days); 
 }
 
+//----------------------------------------------------------------------------
+// Packed representation: days * TICKS_PER_DAY + ticks.  Unpacking floors 
+// towards negative infinity so ticks always stays within [0, TICKS_PER_DAY).
+inline const packedtime_t EpochCounter::packed() const
+{
+  return static_cast<packedtime_t>(m_days) * TICKS_PER_DAY + m_ticks;
+}
+inline void EpochCounter::packed(const packedtime_t& packed)
+{
+  packedtime_t days = packed / TICKS_PER_DAY;
+  packedtime_t ticks = packed % TICKS_PER_DAY;
+  if (ticks < 0) 
+  {
+    --days;
+    ticks += TICKS_PER_DAY;
+  }
+  m_days = static_cast<datecount_t>(days);
+  m_ticks = static_cast<tickcount_t>(ticks);
+}
+
 //----------------------------------------------------------------------------
 // Increment/Decrement
 inline void EpochCounter::operator+= (const EpochCounter& other) 
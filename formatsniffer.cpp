@@ -0,0 +1,334 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "formatsniffer.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <cctype>
+#include <cstdlib>
+
+namespace dragonfly {
+
+namespace {
+  inline bool is_digit(const char c) { return c >= '0' && c <= '9'; }
+  inline bool is_space(const char c)
+  { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+  // Bytes outside ASCII count as letters, so UTF-8 month names stay whole.
+  inline bool is_alpha(const char c)
+  { return std::isalpha(static_cast<unsigned char>(c)) || (c & 0x80); }
+
+  const std::string lower(const std::string& s)
+  {
+    std::string out(s);
+    for (std::string::size_type i = 0; i < out.size(); ++i)
+      out[i] = std::tolower(static_cast<unsigned char>(out[i]));
+    return out;
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+FormatSniffer::FormatSniffer()
+{
+  // Ask the locale what its AM/PM indicators look like, the same way
+  // DateFormatter::load_names does.
+  TimeStruct temp;
+  std::ostringstream os;
+  std::time_put<char> const& facet =
+    std::use_facet< std::time_put<char> >( os.getloc() );
+  const char pat[2] = { '%', 'p' };
+  facet.put(os, os, os.fill(), &temp, pat, pat + sizeof(pat));
+  am_ = lower(os.str());
+  os.str("");
+  temp.tm_hour = 13;
+  facet.put(os, os, os.fill(), &temp, pat, pat + sizeof(pat));
+  pm_ = lower(os.str());
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void FormatSniffer::tokenize(const std::string& text, Tokens& tokens)
+{
+  tokens.clear();
+  for (std::string::size_type i = 0; i < text.size(); ) {
+    Token t;
+    std::string::size_type j = i + 1;
+    if (is_digit(text[i])) {
+      t.kind = DIGITS;
+      while (j < text.size() && is_digit(text[j])) ++j;
+    }
+    else if (is_alpha(text[i])) {
+      t.kind = ALPHA;
+      while (j < text.size() && is_alpha(text[j])) ++j;
+    }
+    else if (is_space(text[i])) {
+      t.kind = SPACE;
+      while (j < text.size() && is_space(text[j])) ++j;
+    }
+    else {
+      t.kind = PUNCT;
+    }
+    t.text = text.substr(i, j - i);
+    tokens.push_back(t);
+    i = j;
+  }
+}
+
+// function:  shape
+// purpose:   A key that's the same for samples that should share a pattern.
+//            One- and two-digit numbers are lumped together, since "8:49"
+//            and "12:05" are the same thing; other digit runs keep their
+//            length, and punctuation is kept as-is.
+//
+DFLY_INLINE
+const std::string FormatSniffer::shape(const Tokens& tokens)
+{
+  std::ostringstream os;
+  for (Tokens::const_iterator t = tokens.begin(); t != tokens.end(); ++t) {
+    switch (t->kind) {
+      case DIGITS:
+        if (t->text.size() <= 2) os << 'n';
+        else os << 'd' << t->text.size();
+        break;
+      case ALPHA: os << 'a'; break;
+      case SPACE: os << ' '; break;
+      case PUNCT: os << 'p' << t->text; break;
+    }
+    os << '|';
+  }
+  return os.str();
+}
+
+// function:  nameField
+// params:    rows: tokenized samples, all of the same shape
+//            pos: index of an ALPHA token
+// returns:   the format tag that matches that word in every row, the word
+//            itself if it's the same everywhere, or "" if neither.
+//
+DFLY_INLINE
+const std::string FormatSniffer::nameField(const std::vector<const Tokens*>& rows,
+                                           const size_t pos)
+{
+  bool abbrev = true, full = true, wabbrev = true, wfull = true, ampm = true;
+  bool same = true;
+  const std::string& first = (*rows[0])[pos].text;
+  for (size_t r = 0; r < rows.size(); ++r) {
+    const std::string& s = (*rows[r])[pos].text;
+    int v;
+    abbrev = abbrev && abbrev_month_.find(s, v);
+    full = full && full_month_.find(s, v);
+    wabbrev = wabbrev && abbrev_weekday_.find(s, v);
+    wfull = wfull && full_weekday_.find(s, v);
+    const std::string l = lower(s);
+    ampm = ampm && !am_.empty() && (l == am_ || l == pm_);
+    same = same && s == first;
+  }
+  if (abbrev) return "%b";
+  if (full) return "%B";
+  if (wabbrev) return "%a";
+  if (wfull) return "%A";
+  if (ampm) return "%p";
+  if (same) return first;
+  return "";
+}
+
+// function:  candidates
+// params:    rows: tokenized samples, all of the same shape
+//            out: candidate patterns, most likely first
+// purpose:   Works out what each token is (see the class comment).  When
+//            the day and month can't be told apart, both orders go out.
+//
+DFLY_INLINE
+void FormatSniffer::candidates(const std::vector<const Tokens*>& rows,
+                               std::vector<std::string>& out)
+{
+  const Tokens& first = *rows[0];
+  const size_t n = first.size();
+
+  std::vector<int> maxval(n, 0);
+  for (size_t r = 0; r < rows.size(); ++r)
+    for (size_t i = 0; i < n; ++i)
+      if ((*rows[r])[i].kind == DIGITS && (*rows[r])[i].text.size() <= 9) {
+        int v = std::atoi((*rows[r])[i].text.c_str());
+        if (v > maxval[i]) maxval[i] = v;
+      }
+
+  std::vector<std::string> piece(n);
+  std::vector<size_t> dates, times;
+  size_t stop = n;
+  int year = -1;
+  bool month = false, ampm = false, compact = false;
+
+  for (size_t i = 0; i < n && stop == n; ++i) {
+    const Token& t = first[i];
+    switch (t.kind) {
+      case SPACE:
+        piece[i] = " ";
+        break;
+      case PUNCT:
+        piece[i] = (t.text == "%") ? "%%" : t.text;
+        break;
+      case ALPHA:
+        piece[i] = nameField(rows, i);
+        if (piece[i].empty()) stop = i;
+        if (piece[i] == "%b" || piece[i] == "%B") month = true;
+        if (piece[i] == "%p") ampm = true;
+        break;
+      case DIGITS:
+        if (t.text.size() <= 2) {
+          bool colon = (i > 0 && first[i-1].text == ":") ||
+                       (i + 1 < n && first[i+1].text == ":");
+          (colon ? times : dates).push_back(i);
+        }
+        else if (t.text.size() == 4 && year < 0) {
+          piece[i] = "%Y";
+          year = static_cast<int>(i);
+        }
+        else if (year < 0 && !month && (t.text.size() == 8 ||
+                 t.text.size() == 12 || t.text.size() == 14)) {
+          const char* compact_fmt[] = { "%Y%m%d", "%Y%m%d%H%M", "%Y%m%d%H%M%S" };
+          piece[i] = compact_fmt[(t.text.size() - 8) / 3];
+          year = static_cast<int>(i);
+          month = compact = true;
+        }
+        else {
+          stop = i;
+        }
+        break;
+    }
+  }
+
+  // Time of day: hour, minute, second in that order.
+  const char* time_fmt[] = { ampm ? "%I" : "%H", "%M", "%S" };
+  for (size_t k = 0; k < times.size(); ++k) {
+    if (k == 3) {
+      stop = std::min(stop, times[k]);
+      break;
+    }
+    piece[times[k]] = time_fmt[k];
+  }
+
+  // Date numbers.  Whatever isn't already known from a name or a four
+  // digit year has to come from these.
+  int ambiguous_a = -1, ambiguous_b = -1;
+  if (compact || (year >= 0 && month)) {
+    if (!dates.empty()) piece[dates[0]] = "%d";
+    if (dates.size() > 1) stop = std::min(stop, dates[1]);
+  }
+  else if (month) {
+    if (!dates.empty()) piece[dates[0]] = "%d";
+    if (dates.size() > 1) piece[dates[1]] = "%y";
+    if (dates.size() > 2) stop = std::min(stop, dates[2]);
+  }
+  else {
+    std::vector<size_t> dm(dates);
+    if (year < 0 && dm.size() >= 3) {
+      // Two-digit year: whichever can't be a day, or else the last one.
+      size_t y = 2;
+      for (size_t k = 0; k < 3; ++k)
+        if (maxval[dm[k]] > 31) y = k;
+      piece[dm[y]] = "%y";
+      year = static_cast<int>(dm[y]);
+      dm.erase(dm.begin() + y);
+    }
+    if (dm.size() >= 2) {
+      const size_t a = dm[0], b = dm[1];
+      if (maxval[a] > 12 && maxval[b] <= 12) {
+        piece[a] = "%d"; piece[b] = "%m";
+      }
+      else if (maxval[b] > 12 && maxval[a] <= 12) {
+        piece[a] = "%m"; piece[b] = "%d";
+      }
+      else {
+        // No way to tell from the values.  Year-first and slashes lean
+        // towards month first; dots and dashes towards day first.
+        bool month_first = (year >= 0 && year < static_cast<int>(a)) ||
+                           (a + 1 < n && first[a+1].text == "/");
+        piece[a] = month_first ? "%m" : "%d";
+        piece[b] = month_first ? "%d" : "%m";
+        ambiguous_a = static_cast<int>(a);
+        ambiguous_b = static_cast<int>(b);
+      }
+      if (dm.size() > 2) stop = std::min(stop, dm[2]);
+    }
+    else if (!dm.empty()) {
+      stop = std::min(stop, dm[0]);
+    }
+  }
+
+  // Trim separators left dangling in front of wherever we gave up.
+  while (stop > 0 && (first[stop-1].kind == SPACE || first[stop-1].kind == PUNCT))
+    --stop;
+  if (stop == 0)
+    return;
+
+  std::string pattern;
+  for (size_t i = 0; i < stop; ++i)
+    pattern += piece[i];
+  out.push_back(pattern);
+
+  if (ambiguous_a >= 0 && ambiguous_b < static_cast<int>(stop)) {
+    std::swap(piece[ambiguous_a], piece[ambiguous_b]);
+    pattern.clear();
+    for (size_t i = 0; i < stop; ++i)
+      pattern += piece[i];
+    out.push_back(pattern);
+  }
+}
+
+// function:  sniff
+// params:    samples: example timestamps from a single source
+// returns:   the best pattern found, and how many samples it parsed.
+// purpose:   Groups the samples by shape, builds candidates from the most
+//            common shape, and keeps whichever candidate parses the most
+//            samples.
+//
+DFLY_INLINE
+const SniffResult FormatSniffer::sniff(const std::vector<std::string>& samples)
+{
+  SniffResult result;
+  result.matched = 0;
+  result.samples = std::min(samples.size(), MAX_SAMPLES);
+
+  std::vector<Tokens> tokens(result.samples);
+  std::map<std::string, std::vector<const Tokens*> > shapes;
+  const std::vector<const Tokens*>* common = 0;
+  for (size_t s = 0; s < result.samples; ++s) {
+    tokenize(samples[s], tokens[s]);
+    if (tokens[s].empty())
+      continue;
+    std::vector<const Tokens*>& rows = shapes[shape(tokens[s])];
+    rows.push_back(&tokens[s]);
+    if (!common || rows.size() > common->size())
+      common = &rows;
+  }
+  if (!common)
+    return result;
+
+  std::vector<std::string> patterns;
+  candidates(*common, patterns);
+
+  for (size_t p = 0; p < patterns.size(); ++p) {
+    DateFormatter formatter(patterns[p]);
+    size_t matched = 0;
+    for (size_t s = 0; s < result.samples; ++s) {
+      try {
+        formatter.parse(samples[s]);
+        ++matched;
+      }
+      catch (const std::exception&) {
+      }
+    }
+    if (matched > result.matched) {
+      result.matched = matched;
+      result.pattern = patterns[p];
+    }
+  }
+  return result;
+}
+
+} // namespace dragonfly
@@ -0,0 +1,86 @@
+#ifndef __FORMATSNIFFER_H__
+#define __FORMATSNIFFER_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "dateformatter.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace dragonfly {
+
+// struct:  SniffResult
+// purpose: What FormatSniffer::sniff came up with.  pattern is empty if no
+//          candidate parsed any of the samples.
+//
+struct SniffResult {
+  std::string pattern;
+  size_t matched;   // samples that pattern parsed
+  size_t samples;   // samples that were tried
+};
+
+// class:   FormatSniffer
+// purpose: Guesses the DateFormatter pattern behind a bunch of sample
+//          timestamps, so a feed with an undocumented format can be handed
+//          to a DateFormatter once instead of trying patterns row by row.
+//
+//          Each sample is broken into runs of digits, letters, whitespace
+//          and punctuation, and the most common shape among the samples is
+//          used to build candidate patterns:
+//            - letters are checked against the locale's month and weekday
+//              names (via LocaleParser) and AM/PM indicators; anything else
+//              must be the same in every sample, like the 'T' in ISO 8601.
+//            - four digits are a year; 8, 12 and 14 digit runs are compact
+//              %Y%m%d[%H%M[%S]] dates.
+//            - small numbers next to ':' are a time of day; the rest are a
+//              day, a month and maybe a two-digit year, told apart by the
+//              ranges of values seen across the samples.  When the values
+//              can't settle day-vs-month, both orders are candidates.
+//          Every candidate is then run through DateFormatter::parse against
+//          the samples, and the one that parses the most wins.  The pattern
+//          only covers as much of the sample as could be identified; parse
+//          doesn't mind trailing text, so "[10/Oct/2000:13:55:36 -0700]"
+//          still yields something usable.
+//
+class FormatSniffer {
+  public:
+    FormatSniffer();
+
+  public:
+    const SniffResult sniff(const std::vector<std::string>& samples);
+
+  public:
+    // Only this many samples are looked at; pass a sample, not the feed.
+    static constexpr size_t MAX_SAMPLES = 1000;
+
+  private:
+    enum Kind { DIGITS, ALPHA, SPACE, PUNCT };
+    struct Token {
+      Kind kind;
+      std::string text;
+    };
+    typedef std::vector<Token> Tokens;
+
+  private:
+    static void tokenize(const std::string& text, Tokens& tokens);
+    static const std::string shape(const Tokens& tokens);
+    const std::string nameField(const std::vector<const Tokens*>& rows,
+                                const size_t pos);
+    void candidates(const std::vector<const Tokens*>& rows,
+                    std::vector<std::string>& out);
+
+  private:
+    AbbrevMonth abbrev_month_;
+    FullMonth full_month_;
+    AbbrevWeekday abbrev_weekday_;
+    FullWeekday full_weekday_;
+    std::string am_, pm_;
+};
+
+} // namespace dragonfly
+
+#endif //__FORMATSNIFFER_H__
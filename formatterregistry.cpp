@@ -0,0 +1,105 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "formatterregistry.h"
+
+namespace dragonfly {
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+FormatterRegistry::FormatterRegistry()
+{
+  Table* empty = new Table;
+  empty->slots.resize(16);
+  empty->count = 0;
+  table_.store(empty);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+FormatterRegistry::~FormatterRegistry()
+{
+  delete table_.load();
+  for (size_t t = 0; t < retired_.size(); ++t)
+    delete retired_[t];
+  for (size_t f = 0; f < formatters_.size(); ++f)
+    delete formatters_[f];
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+FormatterRegistry& FormatterRegistry::global()
+{
+  static FormatterRegistry registry;
+  return registry;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void FormatterRegistry::insert(Table& table, const Entry& entry)
+{
+  const size_t mask = table.slots.size() - 1;
+  size_t s = entry.hash & mask;
+  while (table.slots[s].formatter)
+    s = (s + 1) & mask;
+  table.slots[s] = entry;
+  ++table.count;
+}
+
+// function:  intern
+// params:    hash: of pattern and locale, from hash()
+//            pattern, locale: not necessarily NUL terminated
+// returns:   the shared formatter for that pattern and locale.
+// purpose:   Slow path of get().  Checks again under the lock, in case
+//            another thread got here first, then publishes a copy of the
+//            table with the new formatter in it.
+//
+DFLY_INLINE
+const DateFormatter& FormatterRegistry::intern(const size_t hash,
+                                               const char* pattern,
+                                               const size_t patternSize,
+                                               const char* locale,
+                                               const size_t localeSize)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Table* current = table_.load(std::memory_order_relaxed);
+  const DateFormatter* found =
+    find(*current, hash, pattern, patternSize, locale, localeSize);
+  if (found)
+    return *found;
+
+  // Build the formatter before touching anything, in case the locale name
+  // is bad.
+  const std::string pat(pattern, patternSize);
+  const DateFormatter* formatter = localeSize == 0 ?
+    new DateFormatter(pat) :
+    new DateFormatter(pat, std::locale(std::string(locale, localeSize).c_str()));
+  formatters_.push_back(formatter);
+
+  Entry entry;
+  entry.hash = hash;
+  entry.key.assign(locale, localeSize);
+  entry.key += '\0';
+  entry.key += pat;
+  entry.formatter = formatter;
+
+  // Keep the table at most half full so probe sequences stay short.
+  size_t slots = current->slots.size();
+  if ((current->count + 1) * 2 > slots)
+    slots *= 2;
+  Table* next = new Table;
+  next->slots.resize(slots);
+  next->count = 0;
+  for (size_t s = 0; s < current->slots.size(); ++s)
+    if (current->slots[s].formatter)
+      insert(*next, current->slots[s]);
+  insert(*next, entry);
+
+  retired_.push_back(current);
+  table_.store(next, std::memory_order_release);
+  return *formatter;
+}
+
+} // namespace dragonfly
@@ -0,0 +1,154 @@
+#ifndef __FORMATTERREGISTRY_H__
+#define __FORMATTERREGISTRY_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "dateformatter.h"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstring>
+#include <cstddef>
+
+namespace dragonfly {
+
+// class:   FormatterRegistry
+// purpose: Interns DateFormatters by (pattern, locale name), so code that
+//          builds formatters on the fly from the same few patterns can share
+//          one immutable instance of each instead.  Everything a formatter
+//          sets up is done once, when its pattern is first seen.
+//
+//          Formatters are never removed; a reference returned by get() is
+//          good for as long as the registry is.  Lookups don't lock: they
+//          read an immutable hash table through an atomic pointer.  Adding
+//          a pattern takes a lock, copies the table with the new entry, and
+//          publishes the copy.  Superseded tables are kept until the
+//          registry goes away, since a reader may still be looking at one,
+//          which is fine for the few dozen patterns this is meant for.
+//
+//          An empty locale name means "no particular locale": like a
+//          DateFormatter built without one, the formatter takes the global
+//          locale in effect when its entry is created, by the first get()
+//          for that pattern, and keeps it.  Any other name is handed to
+//          std::locale, which throws std::runtime_error if it's unknown.
+//
+class FormatterRegistry {
+  public:
+    FormatterRegistry();
+    ~FormatterRegistry();
+
+  public:
+    const DateFormatter& get(const char* pattern, const char* locale = "")
+    {
+      return get(pattern, std::strlen(pattern), locale, std::strlen(locale));
+    }
+    const DateFormatter& get(const std::string& pattern,
+                             const std::string& locale = std::string())
+    {
+      return get(pattern.data(), pattern.size(), locale.data(), locale.size());
+    }
+    const DateFormatter& get(const char* pattern, const size_t patternSize,
+                             const char* locale, const size_t localeSize);
+
+  public:
+    // Number of distinct (pattern, locale) formatters interned so far.
+    const size_t size() const { return table_.load()->count; }
+
+  public:
+    // A process-wide registry, for code that doesn't want to own one.
+    static FormatterRegistry& global();
+
+  private:
+    struct Entry {
+      size_t hash;
+      std::string key;            // locale name, '\0', pattern
+      const DateFormatter* formatter;
+    };
+    struct Table {
+      std::vector<Entry> slots;   // open addressing; power-of-two size
+      size_t count;
+    };
+
+  private:
+    FormatterRegistry(const FormatterRegistry&);
+    FormatterRegistry& operator= (const FormatterRegistry&);
+
+    static size_t hash(const char* pattern, const size_t patternSize,
+                       const char* locale, const size_t localeSize);
+    static const DateFormatter* find(const Table& table, const size_t hash,
+                                     const char* pattern, const size_t patternSize,
+                                     const char* locale, const size_t localeSize);
+    static void insert(Table& table, const Entry& entry);
+    const DateFormatter& intern(const size_t hash,
+                                const char* pattern, const size_t patternSize,
+                                const char* locale, const size_t localeSize);
+
+  private:
+    std::atomic<const Table*> table_;
+    std::mutex mutex_;                              // serializes inserts
+    std::vector<const Table*> retired_;
+    std::vector<const DateFormatter*> formatters_;
+};
+
+// function:  FormatterRegistry::get
+// params:    pattern, locale: not necessarily NUL terminated
+// returns:   the shared formatter for that pattern and locale.
+// purpose:   The fast path, inline so a hit costs a hash and a compare.
+//            Misses go to intern(), which takes the lock.
+//
+inline
+const DateFormatter& FormatterRegistry::get(const char* pattern,
+                                            const size_t patternSize,
+                                            const char* locale,
+                                            const size_t localeSize)
+{
+  const size_t h = hash(pattern, patternSize, locale, localeSize);
+  const DateFormatter* found = find(*table_.load(std::memory_order_acquire),
+                                    h, pattern, patternSize, locale, localeSize);
+  if (found)
+    return *found;
+
+  return intern(h, pattern, patternSize, locale, localeSize);
+}
+
+//-----------------------------------------------------------------------------
+inline size_t FormatterRegistry::hash(const char* pattern, const size_t patternSize,
+                                      const char* locale, const size_t localeSize)
+{
+  // FNV-1a over the locale name, a separator, and the pattern.
+  size_t h = 2166136261u;
+  for (size_t i = 0; i < localeSize; ++i)
+    h = (h ^ static_cast<unsigned char>(locale[i])) * 16777619u;
+  h = h * 16777619u;
+  for (size_t i = 0; i < patternSize; ++i)
+    h = (h ^ static_cast<unsigned char>(pattern[i])) * 16777619u;
+  return h;
+}
+
+//-----------------------------------------------------------------------------
+inline const DateFormatter* FormatterRegistry::find(const Table& table,
+                                                    const size_t hash,
+                                                    const char* pattern,
+                                                    const size_t patternSize,
+                                                    const char* locale,
+                                                    const size_t localeSize)
+{
+  const size_t mask = table.slots.size() - 1;
+  for (size_t s = hash & mask; ; s = (s + 1) & mask) {
+    const Entry& e = table.slots[s];
+    if (!e.formatter)
+      return 0;
+    if (e.hash == hash && e.key.size() == localeSize + 1 + patternSize &&
+        std::memcmp(e.key.data(), locale, localeSize) == 0 &&
+        std::memcmp(e.key.data() + localeSize + 1, pattern, patternSize) == 0)
+      return e.formatter;
+  }
+}
+
+} // namespace dragonfly
+
+#endif //__FORMATTERREGISTRY_H__
@@ -8,6 +8,7 @@
 
 #include "epochcounter.h"
 #include "dateexception.h"
+#include "dateinstrument.h"
 #include <vector>
 #include <exception>
 #include <ctime>
@@ -24,7 +25,7 @@ class Gregorian : public EpochCounter {
        time(hour, minute, second); 
     }
     Gregorian(const struct tm ts) { 
-      set(ts.tm_year, ts.tm_mon, ts.tm_mday); 
+      set(ts.tm_year + 1900, ts.tm_mon + 1, ts.tm_mday); // see getTimeStruct
       time(ts.tm_hour, ts.tm_min, ts.tm_sec);
     }
     virtual ~Gregorian() {};
@@ -57,28 +58,38 @@ class Gregorian : public EpochCounter {
     void setMidnight();
               
   private:
-    static const int c_daycount_a[14];
-    static const int c_leapdaycount_a[14];
-    static const std::vector<int> c_daycount;
-    static const std::vector<int> c_leapdaycount;
-
-    static const int c_lastday_a[12];
-    static const int c_leaplastday_a[12];
-    static const std::vector<int> c_lastday;
-    static const std::vector<int> c_leaplastday;
+    // Days before the start of each month (index 0=Jan), and the length of
+    // each month.  Defined here so they can be folded into callers.
+    static constexpr int c_daycount[14] =
+      {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365, 365};
+    static constexpr int c_leapdaycount[14] =
+      {0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366, 366};
+
+    static constexpr int c_lastday[12] =
+      {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    static constexpr int c_leaplastday[12] =
+      {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
               
-  protected:
+  public:
     // Is given year a leap year?
-    const bool isLeapYear(const int y) const
+    static const bool isLeapYear(const int y)
     { return (y>0) && !(y%4) && ( (y%100) || !(y%400) ); }
     
     // Count the number of leap years from epoch to Jan 1st of year provided.
-    const int countLeaps(const int y) const
+    static const int countLeaps(const int y)
     { return (y-1)/4 - (y-1)/100 + (y-1)/400; }
     
     // Count the number of days between epoch and Jan 1st of year provided.
-    const int countDays(const int y) const
+    static const int countDays(const int y)
     { return y*365 + countLeaps(y); }
+
+    // Days in the year provided before the 1st of month m (1=Jan).
+    static const int countMonthDays(const int y, const int m)
+    { return (isLeapYear(y) ? c_leapdaycount : c_daycount)[m-1]; }
+
+    // Number of days in month m (1=Jan) of the year provided.
+    static const int monthLength(const int y, const int m)
+    { return (isLeapYear(y) ? c_leaplastday : c_lastday)[m-1]; }
 };
 
 //-----------------------------------------------------------------------------
@@ -106,6 +117,7 @@ inline const int Gregorian::year() const
   if (days() >= EPOCH_2000 && days() < EPOCH_2100)
   {
     // Optimized for 2000 -> 2100. 
+    DFLY_COUNT(YEAR_FAST_2000);
     x = 5; a = 0; 
     b = (days() - EPOCH_2000 - 1)/DAYS_PER_4;
     c = (days() - EPOCH_2000 - 1) - b*DAYS_PER_4;
@@ -113,6 +125,7 @@ inline const int Gregorian::year() const
   else if (days() >= EPOCH_1900 && days() < EPOCH_2000)
   {
     // Optimized for 1900 -> 2000.
+    DFLY_COUNT(YEAR_FAST_1900);
     x = 4; a = 3; 
     b = (days() - EPOCH_1900)/DAYS_PER_4;
     c = (days() - EPOCH_1900) - b*DAYS_PER_4;
@@ -120,6 +133,7 @@ inline const int Gregorian::year() const
   else
   {
     // Standard, un-optimized, works-every-time version.  
+    DFLY_COUNT(YEAR_GENERIC);
     x = days(); 
     a = x%DAYS_PER_400; x/=DAYS_PER_400; // whole 400yr intervals
     b = a%DAYS_PER_100; a/=DAYS_PER_100; // whole 100yr intervals
@@ -138,7 +152,8 @@ inline const int Gregorian::year() const
 //-----------------------------------------------------------------------------
 inline const int Gregorian::month() const
 {
-  const std::vector<int>& month_days =
+  DFLY_COUNT(MONTH_CALLS);
+  const int* month_days =
     (isLeapYear(year()) ? c_leapdaycount : c_daycount);
   
   // guess is trying to predict month where 0=Jan... need to
@@ -150,7 +165,8 @@ inline const int Gregorian::month() const
 //-----------------------------------------------------------------------------
 inline const int Gregorian::day() const
 {
-  const std::vector<int>& month_days =
+  DFLY_COUNT(DAY_CALLS);
+  const int* month_days =
     (isLeapYear(year()) ? c_leapdaycount : c_daycount);
 
   return dayOfYear() - month_days[month()-1]; 
@@ -162,6 +178,7 @@ inline const int Gregorian::day() const
 //
 inline const int Gregorian::dayOfWeek() const
 {
+  DFLY_COUNT(DAY_OF_WEEK_CALLS);
   int m(month()), y(year());
   if (m < 3) { 
     m = m + 12; 
@@ -174,18 +191,27 @@ inline const int Gregorian::dayOfWeek() const
 //-----------------------------------------------------------------------------
 // Warning!  GetDayOfYear() is 1->365.  Days since epoch is zero-based.
 inline const int Gregorian::dayOfYear() const
-{ return EpochCounter::days() - countDays(year()) + 1; }
+{ 
+  DFLY_COUNT(DAY_OF_YEAR_CALLS);
+  return EpochCounter::days() - countDays(year()) + 1; 
+}
 
 //-----------------------------------------------------------------------------
 inline void Gregorian::set(const int y, const int m, const int d)
 {
-  if (m<1 || m>12 || y<0) throw DateValueOutOfRangeException();
+  if (m<1 || m>12 || y<0) { 
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
   bool leap = isLeapYear(y);
-  const std::vector<int>& last_day = leap ? c_leaplastday : c_lastday;
-  if (d<1 || d>last_day[m]) throw DateValueOutOfRangeException();
+  const int* last_day = leap ? c_leaplastday : c_lastday;
+  if (d<1 || d>last_day[m-1]) {
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
 
   int days = countDays(y);  
-  const std::vector<int>& month_days = leap ? c_leapdaycount : c_daycount;
+  const int* month_days = leap ? c_leapdaycount : c_daycount;
 
   days += (month_days[(m-1)] + d) - 1;  // epoch is the zero'th day.
   EpochCounter::days(days);
@@ -210,9 +236,10 @@ inline const int Gregorian::subSecond() const
 //-----------------------------------------------------------------------------
 inline void Gregorian::time(const int hour, const int min, const int sec)
 {
-  if (hour<0 || hour>23) throw DateValueOutOfRangeException();
-  if (min<0 || min>59) throw DateValueOutOfRangeException();
-  if (sec<0 || sec>60) throw DateValueOutOfRangeException();  // leap seconds?
+  if (hour<0 || hour>23 || min<0 || min>59 || sec<0 || sec>60) { // leap seconds?
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
 
   int ticks = (sec * EpochCounter::TICKS_PER_SECOND) 
             + (min * EpochCounter::TICKS_PER_MINUTE) 
@@ -227,14 +254,27 @@ inline void Gregorian::setMidnight()
 //-----------------------------------------------------------------------------
 inline const struct tm Gregorian::getTimeStruct() const
 {
+  DFLY_COUNT(TIME_STRUCT_CALLS);
+  // Same arithmetic as year(), month(), day() and dayOfWeek(), but finding
+  // the year only once rather than in every one of them.
+  const int y = this->year();
+  const int* month_days = (isLeapYear(y) ? c_leapdaycount : c_daycount);
+  const int yday = EpochCounter::days() - countDays(y) + 1;
+  const int guess = yday/30;
+  const int m = (yday <= month_days[guess] ? guess : guess+1);
+  const int d = yday - month_days[m-1];
+  const int zm = m < 3 ? m + 12 : m, zy = m < 3 ? y - 1 : y;
+
   struct tm timestruct;
   timestruct.tm_sec  = this->second();
   timestruct.tm_min  = this->minute();
   timestruct.tm_hour = this->hour();
-  timestruct.tm_mday = this->day();
-  timestruct.tm_wday = this->dayOfWeek();
-  timestruct.tm_mon  = this->month() - 1;   // UNIX tm struct months 0-11.
-  timestruct.tm_year = this->year() - 1900; // UNIX tm struct starts at 1900 AD.
+  timestruct.tm_mday = d;
+  timestruct.tm_wday = (2 + d + (13*zm-2)/5 + zy + zy/4 - zy/100 + zy/400) % 7;
+  timestruct.tm_mon  = m - 1;       // UNIX tm struct months 0-11.
+  timestruct.tm_year = y - 1900;    // UNIX tm struct starts at 1900 AD.
+  timestruct.tm_yday = yday - 1;    // 0-365, for %j.
+  timestruct.tm_isdst = 0;
   return timestruct;
 }
 
@@ -0,0 +1,396 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "interval.h"
+
+#include <algorithm>
+
+namespace dragonfly {
+
+namespace {
+  inline bool startsBefore(const TimeSpan& a, const TimeSpan& b)
+  { return a.begin < b.begin; }
+
+  // function:  appendSpan
+  // purpose:   Adds s to the end of a normalized list, merging it with the
+  //            last span if they overlap or touch.  s must not start before
+  //            the last span does.
+  //
+  inline void appendSpan(std::vector<TimeSpan>& spans, const TimeSpan& s)
+  {
+    if (s.begin >= s.end)
+      return;
+    if (!spans.empty() && s.begin <= spans.back().end) {
+      if (s.end > spans.back().end)
+        spans.back().end = s.end;
+    }
+    else
+      spans.push_back(s);
+  }
+
+  void unionSpans(const std::vector<TimeSpan>& a,
+                  const std::vector<TimeSpan>& b, std::vector<TimeSpan>& out)
+  {
+    out.reserve(a.size() + b.size());
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+      if (j == b.size() || (i < a.size() && a[i].begin <= b[j].begin))
+        appendSpan(out, a[i++]);
+      else
+        appendSpan(out, b[j++]);
+    }
+  }
+
+  // Whichever span ends first can't overlap anything after the other one.
+  void intersectSpans(const std::vector<TimeSpan>& a,
+                      const std::vector<TimeSpan>& b,
+                      std::vector<TimeSpan>& out)
+  {
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+      const TimeSpan s = { std::max(a[i].begin, b[j].begin),
+                           std::min(a[i].end, b[j].end) };
+      if (s.begin < s.end)
+        out.push_back(s);
+      if (a[i].end < b[j].end)
+        ++i;
+      else
+        ++j;
+    }
+  }
+
+  // Each span of a, minus the spans of b that fall in it.
+  void subtractSpans(const std::vector<TimeSpan>& a,
+                     const std::vector<TimeSpan>& b,
+                     std::vector<TimeSpan>& out)
+  {
+    size_t j = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+      packedtime_t from = a[i].begin;
+      while (j < b.size() && b[j].end <= from)
+        ++j;
+      for (; j < b.size() && b[j].begin < a[i].end; ++j) {
+        if (b[j].begin > from) {
+          const TimeSpan s = { from, b[j].begin };
+          out.push_back(s);
+        }
+        from = b[j].end;
+        if (from >= a[i].end)
+          break;
+      }
+      if (from < a[i].end) {
+        const TimeSpan s = { from, a[i].end };
+        out.push_back(s);
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+IntervalSet::IntervalSet(const TimeSpan* spans, const size_t n)
+{
+  std::vector<TimeSpan> sorted(spans, spans + n);
+  std::sort(sorted.begin(), sorted.end(), startsBefore);
+  spans_.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+    appendSpan(spans_, sorted[i]);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void IntervalSet::add(const Interval& interval)
+{
+  add(interval.span());
+}
+
+// function:  add
+// purpose:   Replaces every span that overlaps or touches span, [first,
+//            last), with one covering all of them and span.
+//
+DFLY_INLINE
+void IntervalSet::add(const TimeSpan& span)
+{
+  if (span.begin >= span.end)
+    return;
+  if (spans_.empty() || span.begin > spans_.back().end) {
+    spans_.push_back(span);
+    return;
+  }
+
+  std::vector<TimeSpan>::iterator first =
+    std::lower_bound(spans_.begin(), spans_.end(), span.begin,
+      [](const TimeSpan& s, const packedtime_t t) { return s.end < t; });
+  std::vector<TimeSpan>::iterator last =
+    std::upper_bound(first, spans_.end(), span.end,
+      [](const packedtime_t t, const TimeSpan& s) { return t < s.begin; });
+  if (first == last) {
+    spans_.insert(first, span);
+    return;
+  }
+  first->begin = std::min(first->begin, span.begin);
+  first->end = std::max((last - 1)->end, span.end);
+  spans_.erase(first + 1, last);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const IntervalSet IntervalSet::operator| (const IntervalSet& other) const
+{
+  IntervalSet result;
+  unionSpans(spans_, other.spans_, result.spans_);
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const IntervalSet IntervalSet::operator& (const IntervalSet& other) const
+{
+  IntervalSet result;
+  intersectSpans(spans_, other.spans_, result.spans_);
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const IntervalSet IntervalSet::operator- (const IntervalSet& other) const
+{
+  IntervalSet result;
+  subtractSpans(spans_, other.spans_, result.spans_);
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+IntervalSet& IntervalSet::operator|= (const IntervalSet& other)
+{
+  std::vector<TimeSpan> result;
+  unionSpans(spans_, other.spans_, result);
+  spans_.swap(result);
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+IntervalSet& IntervalSet::operator&= (const IntervalSet& other)
+{
+  std::vector<TimeSpan> result;
+  intersectSpans(spans_, other.spans_, result);
+  spans_.swap(result);
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+IntervalSet& IntervalSet::operator-= (const IntervalSet& other)
+{
+  std::vector<TimeSpan> result;
+  subtractSpans(spans_, other.spans_, result);
+  spans_.swap(result);
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const bool IntervalSet::operator== (const IntervalSet& other) const
+{
+  if (spans_.size() != other.spans_.size())
+    return false;
+  for (size_t i = 0; i < spans_.size(); ++i)
+    if (spans_[i].begin != other.spans_[i].begin ||
+        spans_[i].end != other.spans_[i].end)
+      return false;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const bool IntervalSet::contains(const Gregorian& when) const
+{
+  return contains(when.packed());
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const bool IntervalSet::contains(const packedtime_t when) const
+{
+  // The last span starting at or before when is the only candidate.
+  std::vector<TimeSpan>::const_iterator i =
+    std::upper_bound(spans_.begin(), spans_.end(), when,
+      [](const packedtime_t t, const TimeSpan& s) { return t < s.begin; });
+  return i != spans_.begin() && when < (i - 1)->end;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const Duration IntervalSet::total() const
+{
+  packedtime_t sum = 0;
+  for (size_t i = 0; i < spans_.size(); ++i)
+    sum += spans_[i].end - spans_[i].begin;
+  EpochCounter c;
+  c.packed(sum);
+  return c;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const size_t IntervalIndex::add(const Interval& interval)
+{
+  return add(interval.span());
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const size_t IntervalIndex::add(const TimeSpan& span)
+{
+  if (span.end < span.begin)
+    throw DateValueOutOfRangeException();
+  const Entry e = { span, span.end, entries_.size() };
+  entries_.push_back(e);
+  indexed_ = false;
+  return e.id;
+}
+
+// function:  index
+// purpose:   Sorts the ranges by start and fills in each node's latest end.
+//
+//            Node i of the sorted array sits at level k of the tree, where
+//            k is the number of trailing one bits in i: even indices are
+//            leaves, and the node at level k has children i +/- 2^(k-1).
+//            Near the end of the array a node's right child can be past
+//            the last range; that subtree's latest end is then the latest
+//            end of the real nodes in it, which is tracked as `last`
+//            (following the implicit tree of Li's cgranges).
+//
+DFLY_INLINE
+void IntervalIndex::index()
+{
+  std::sort(entries_.begin(), entries_.end(),
+    [](const Entry& a, const Entry& b) { return a.span.begin < b.span.begin; });
+  indexed_ = true;
+  const size_t n = entries_.size();
+  if (n == 0) {
+    levels_ = -1;
+    return;
+  }
+
+  size_t lastNode = 0;
+  for (size_t i = 0; i < n; i += 2) {
+    entries_[i].latest = entries_[i].span.end;
+    lastNode = i;
+  }
+  packedtime_t last = entries_[lastNode].latest;
+  int k = 1;
+  for (; (static_cast<size_t>(1) << k) <= n; ++k) {
+    const size_t half = static_cast<size_t>(1) << (k - 1);
+    for (size_t i = 2 * half - 1; i < n; i += 4 * half) {
+      const packedtime_t left = entries_[i - half].latest;
+      const packedtime_t right = i + half < n ? entries_[i + half].latest : last;
+      entries_[i].latest = std::max(entries_[i].span.end, std::max(left, right));
+    }
+    lastNode = (lastNode >> k & 1) ? lastNode - half : lastNode + half;
+    if (lastNode < n && entries_[lastNode].latest > last)
+      last = entries_[lastNode].latest;
+  }
+  levels_ = k - 1;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void IntervalIndex::clear()
+{
+  entries_.clear();
+  levels_ = -1;
+  indexed_ = true;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const size_t IntervalIndex::stab(const Gregorian& when,
+                                 std::vector<size_t>& ids) const
+{
+  return stab(when.packed(), ids);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const size_t IntervalIndex::stab(const packedtime_t when,
+                                 std::vector<size_t>& ids) const
+{
+  const TimeSpan instant = { when, when + 1 };
+  return overlapping(instant, ids);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const size_t IntervalIndex::overlapping(const Interval& range,
+                                        std::vector<size_t>& ids) const
+{
+  return overlapping(range.span(), ids);
+}
+
+// function:  overlapping
+// purpose:   Walks the tree in order with an explicit stack, skipping left
+//            subtrees whose ranges all end by range.begin and stopping at
+//            the first node that starts at or after range.end.  Subtrees
+//            of 15 nodes or fewer are just scanned.  Empty ranges, in the
+//            index or as the query, never match, as with Interval::overlaps.
+//
+DFLY_INLINE
+const size_t IntervalIndex::overlapping(const TimeSpan& range,
+                                        std::vector<size_t>& ids) const
+{
+  if (!indexed_)
+    throw DateValueOutOfRangeException();
+  const size_t found = ids.size();
+  if (levels_ < 0 || range.end <= range.begin)
+    return 0;
+
+  struct Frame {
+    size_t node;
+    int level;
+    bool leftDone;
+  };
+  Frame stack[128];
+  int top = 0;
+  const size_t n = entries_.size();
+  const Frame root = { (static_cast<size_t>(1) << levels_) - 1, levels_, false };
+  stack[top++] = root;
+
+  while (top) {
+    const Frame f = stack[--top];
+    if (f.level <= 3) {
+      const size_t first = f.node >> f.level << f.level;
+      const size_t end =
+        std::min(n, first + (static_cast<size_t>(2) << f.level) - 1);
+      for (size_t i = first; i < end && entries_[i].span.begin < range.end; ++i)
+        if (range.begin < entries_[i].span.end &&
+            entries_[i].span.begin < entries_[i].span.end)
+          ids.push_back(entries_[i].id);
+    }
+    else if (!f.leftDone) {
+      const size_t half = static_cast<size_t>(1) << (f.level - 1);
+      const Frame self = { f.node, f.level, true };
+      stack[top++] = self;
+      // A left child past the end still has real nodes under it.
+      if (f.node - half >= n || entries_[f.node - half].latest > range.begin) {
+        const Frame left = { f.node - half, f.level - 1, false };
+        stack[top++] = left;
+      }
+    }
+    else if (f.node < n && entries_[f.node].span.begin < range.end) {
+      if (range.begin < entries_[f.node].span.end &&
+          entries_[f.node].span.begin < entries_[f.node].span.end)
+        ids.push_back(entries_[f.node].id);
+      const Frame right =
+        { f.node + (static_cast<size_t>(1) << (f.level - 1)), f.level - 1, false };
+      stack[top++] = right;
+    }
+  }
+  return ids.size() - found;
+}
+
+} // namespace dragonfly
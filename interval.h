@@ -0,0 +1,253 @@
+#ifndef __INTERVAL_H__
+#define __INTERVAL_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Ranges of time.
+//
+// Every range here is half-open: it includes its start and stops just short
+// of its end, so [9:00, 10:00) and [10:00, 11:00) meet without overlapping,
+// and an hour-long window is start + Hours(1) with no off-by-one tick.
+//
+// Interval is a single range, for use with DateTimes and Durations.
+// IntervalSet and IntervalIndex hold lots of them, as TimeSpans of packed
+// times (see EpochCounter::packed), which compare and subtract as plain
+// integers:
+//
+//   IntervalSet is a normalized set: sorted, with overlapping and touching
+//   ranges merged.  Union, intersection and difference of two sets are
+//   single linear merges.
+//
+//   IntervalIndex holds ranges that may overlap, each with an id, and
+//   answers "which ranges contain this instant" (or overlap this range) in
+//   O(log n + answers).
+
+#include "datetime.h"
+#include "duration.h"
+#include "datetypes.h"
+#include "dateexception.h"
+#include "dateinstrument.h"
+#include <vector>
+#include <cstddef>
+
+namespace dragonfly {
+
+// struct:  TimeSpan
+// purpose: [begin, end) in packed times.
+//
+struct TimeSpan {
+  packedtime_t begin;
+  packedtime_t end;
+};
+
+// class:   Interval
+// purpose: [start, end) between two DateTimes.
+//
+class Interval {
+  public:
+    // Throws DateValueOutOfRangeException if end is before start.
+    Interval(const Gregorian& start, const Gregorian& end);
+    Interval(const Gregorian& start, const Duration& length);
+    Interval(const TimeSpan& span);
+
+  public:
+    const DateTime start() const;
+    const DateTime end() const;
+    const Duration length() const;
+    const TimeSpan span() const { return span_; }
+    const bool empty() const { return span_.begin == span_.end; }
+
+  public:
+    const bool contains(const Gregorian& when) const;
+    const bool contains(const Interval& other) const;
+    // False if either is empty.
+    const bool overlaps(const Interval& other) const;
+    // The part of both; empty (at the later start) if they don't overlap.
+    const Interval intersection(const Interval& other) const;
+
+  public:
+    const bool operator== (const Interval& other) const
+    { return span_.begin == other.span_.begin && span_.end == other.span_.end; }
+    const bool operator!= (const Interval& other) const
+    { return !(*this == other); }
+
+  private:
+    TimeSpan span_;
+};
+
+// class:   IntervalSet
+// purpose: A set of instants, stored as the fewest sorted, disjoint spans
+//          that cover it.  Empty spans are dropped and spans that overlap
+//          or touch are merged as they're added, so two sets holding the
+//          same instants always compare equal.
+//
+class IntervalSet {
+  public:
+    IntervalSet() {}
+    // Any spans, in any order; sorted and merged in O(n log n).
+    IntervalSet(const TimeSpan* spans, const size_t n);
+
+  public:
+    // O(log n) to find the place, plus moving whatever's after it.  Adding
+    // in time order is amortized constant.
+    void add(const Interval& interval);
+    void add(const TimeSpan& span);
+    void clear() { spans_.clear(); }
+
+  public:
+    const IntervalSet operator| (const IntervalSet& other) const;
+    const IntervalSet operator& (const IntervalSet& other) const;
+    const IntervalSet operator- (const IntervalSet& other) const;
+    IntervalSet& operator|= (const IntervalSet& other);
+    IntervalSet& operator&= (const IntervalSet& other);
+    IntervalSet& operator-= (const IntervalSet& other);
+    const bool operator== (const IntervalSet& other) const;
+    const bool operator!= (const IntervalSet& other) const
+    { return !(*this == other); }
+
+  public:
+    // O(log n).
+    const bool contains(const Gregorian& when) const;
+    const bool contains(const packedtime_t when) const;
+    // Everything the set covers, added up.
+    const Duration total() const;
+
+  public:
+    const size_t size() const { return spans_.size(); }
+    const bool empty() const { return spans_.empty(); }
+    const Interval operator[] (const size_t i) const
+    { return Interval(spans_[i]); }
+    const std::vector<TimeSpan>& spans() const { return spans_; }
+
+  private:
+    std::vector<TimeSpan> spans_;
+};
+
+// class:   IntervalIndex
+// purpose: Stabbing and overlap queries over ranges that may overlap, such
+//          as every booking in a calendar.
+//
+//          add() the ranges, then index() them; queries before index(), or
+//          after an add() since, throw DateValueOutOfRangeException.  The
+//          index is an implicit interval tree: the ranges are sorted by
+//          start and the sorted array itself is the tree, with each node
+//          also holding the latest end under it, so subtrees that end
+//          before the query are skipped.  It costs 8 bytes a range on top
+//          of the ranges themselves.
+//
+class IntervalIndex {
+  public:
+    IntervalIndex() : levels_(-1), indexed_(true) {}
+
+  public:
+    // Returns the range's id, which is the number of ranges added before
+    // it.  Empty ranges are kept (so the ids line up) but never match.
+    const size_t add(const Interval& interval);
+    const size_t add(const TimeSpan& span);
+    void index();
+    void clear();
+
+  public:
+    // Appends the ids of the ranges containing when (or overlapping
+    // range) to ids, in no particular order, and returns how many.
+    const size_t stab(const Gregorian& when, std::vector<size_t>& ids) const;
+    const size_t stab(const packedtime_t when, std::vector<size_t>& ids) const;
+    const size_t overlapping(const Interval& range,
+                             std::vector<size_t>& ids) const;
+    const size_t overlapping(const TimeSpan& range,
+                             std::vector<size_t>& ids) const;
+
+  public:
+    const size_t size() const { return entries_.size(); }
+
+  private:
+    struct Entry {
+      TimeSpan span;
+      packedtime_t latest;   // latest end in this node's subtree
+      size_t id;
+    };
+
+  private:
+    std::vector<Entry> entries_;
+    int levels_;             // height of the tree; -1 when empty
+    bool indexed_;
+};
+
+//-----------------------------------------------------------------------------
+inline Interval::Interval(const Gregorian& start, const Gregorian& end)
+{
+  span_.begin = start.packed();
+  span_.end = end.packed();
+  if (span_.end < span_.begin) {
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
+}
+inline Interval::Interval(const Gregorian& start, const Duration& length)
+{
+  span_.begin = start.packed();
+  span_.end = span_.begin + length.packed();
+  if (span_.end < span_.begin) {
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
+}
+inline Interval::Interval(const TimeSpan& span) : span_(span)
+{
+  if (span_.end < span_.begin) {
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
+}
+
+//-----------------------------------------------------------------------------
+inline const DateTime Interval::start() const
+{
+  DateTime d;
+  d.packed(span_.begin);
+  return d;
+}
+inline const DateTime Interval::end() const
+{
+  DateTime d;
+  d.packed(span_.end);
+  return d;
+}
+inline const Duration Interval::length() const
+{
+  EpochCounter c;
+  c.packed(span_.end - span_.begin);
+  return c;
+}
+
+//-----------------------------------------------------------------------------
+inline const bool Interval::contains(const Gregorian& when) const
+{
+  const packedtime_t t = when.packed();
+  return span_.begin <= t && t < span_.end;
+}
+inline const bool Interval::contains(const Interval& other) const
+{
+  return span_.begin <= other.span_.begin && other.span_.end <= span_.end;
+}
+inline const bool Interval::overlaps(const Interval& other) const
+{
+  return span_.begin < other.span_.end && other.span_.begin < span_.end &&
+         !empty() && !other.empty();
+}
+inline const Interval Interval::intersection(const Interval& other) const
+{
+  TimeSpan s;
+  s.begin = span_.begin > other.span_.begin ? span_.begin : other.span_.begin;
+  s.end = span_.end < other.span_.end ? span_.end : other.span_.end;
+  if (s.end < s.begin)
+    s.end = s.begin;
+  return Interval(s);
+}
+
+} // namespace dragonfly
+
+#endif //__INTERVAL_H__
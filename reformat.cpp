@@ -0,0 +1,305 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// reformat: rewrites the timestamp on every line of a (large) log file from
+// one DateFormatter format to another, e.g. Apache access log times to
+// ISO 8601:
+//
+//   reformat -d '[' '%d/%b/%Y:%H:%M:%S' '%Y-%m-%dT%H:%M:%S' access.log out.log
+//
+// The input is mmap'd and cut into newline-aligned chunks, which a pool of
+// worker threads converts.  Each worker starts with its own run of chunks and
+// steals from the back of another worker's run when it runs dry.  Finished
+// chunks are written out in their original order.  Lines whose timestamp
+// doesn't parse are copied through unchanged.  Throughput goes to stderr.
+
+#include "datetime.h"
+#include "dateformatter.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace dragonfly;
+
+namespace {
+
+const size_t CHUNK_BYTES = 4 << 20;
+
+struct Chunk {
+  const char* begin;
+  const char* end;
+  std::string output;
+  unsigned long long lines;
+  unsigned long long failures;
+  bool done;
+};
+
+// class:   WorkQueue
+// purpose: One worker's run of chunk indices.  The owner takes from the
+//          front, thieves take from the back, so the two only meet when
+//          the run is nearly gone.
+//
+class WorkQueue {
+  public:
+    void push(size_t chunk) { chunks_.push_back(chunk); }
+    bool take(size_t& chunk) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (chunks_.empty()) return false;
+      chunk = chunks_.front();
+      chunks_.pop_front();
+      return true;
+    }
+    bool steal(size_t& chunk) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (chunks_.empty()) return false;
+      chunk = chunks_.back();
+      chunks_.pop_back();
+      return true;
+    }
+  private:
+    std::mutex mutex_;
+    std::deque<size_t> chunks_;
+};
+
+struct Job {
+  const DateFormatter* in;   // built once in main, shared by the workers
+  const DateFormatter* out;
+  char delim;           // timestamp follows the first delim; 0 = line start
+  std::vector<Chunk> chunks;
+  std::vector<WorkQueue> queues;
+  std::mutex doneMutex;
+  std::condition_variable doneCond;
+};
+
+// function:  convert
+// params:    in, out: see Job
+//            delim: see Job::delim
+//            chunk: the chunk to convert
+// purpose:   Converts every line in the chunk, appending to chunk.output.
+//
+void convert(const DateFormatter& in, const DateFormatter& out,
+             const char delim, Chunk& chunk)
+{
+  std::string& result = chunk.output;
+  result.reserve((chunk.end - chunk.begin) + (chunk.end - chunk.begin) / 8);
+
+  for (const char* line = chunk.begin; line < chunk.end; ) {
+    const char* eol = static_cast<const char*>(
+      std::memchr(line, '\n', chunk.end - line));
+    const char* next = eol ? eol + 1 : chunk.end;
+    if (!eol) eol = chunk.end;
+    ++chunk.lines;
+
+    const char* start = line;
+    if (delim) {
+      start = static_cast<const char*>(std::memchr(line, delim, eol - line));
+      start = start ? start + 1 : 0;
+    }
+
+    bool converted = false;
+    if (start) {
+      try {
+        unsigned int length = 0;
+        DateTime date = in.parse(start, eol - start, length);
+        result.append(line, start);
+        result.append(out.format(date));
+        result.append(start + length, next);
+        converted = true;
+      }
+      catch (const std::exception&) {
+      }
+    }
+    if (!converted) {
+      ++chunk.failures;
+      result.append(line, next);
+    }
+    line = next;
+  }
+}
+
+// function:  worker
+// params:    job: shared job description
+//            self: this worker's queue
+// purpose:   Thread body.  The workers all use job's formatters: parse
+//            and format are const and touch no shared mutable state, so
+//            one DateFormatter can serve any number of threads.
+//
+void worker(Job& job, size_t self)
+{
+  const size_t workers = job.queues.size();
+  for (;;) {
+    size_t c;
+    bool found = job.queues[self].take(c);
+    for (size_t v = 1; !found && v < workers; ++v)
+      found = job.queues[(self + v) % workers].steal(c);
+    if (!found)
+      return;
+
+    convert(*job.in, *job.out, job.delim, job.chunks[c]);
+    {
+      std::lock_guard<std::mutex> lock(job.doneMutex);
+      job.chunks[c].done = true;
+    }
+    job.doneCond.notify_all();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void usage()
+{
+  std::cerr << "usage: reformat [-t threads] [-d delim] infmt outfmt "
+               "input [output]" << std::endl
+            << "  -t threads  worker threads (default: all cores)" << std::endl
+            << "  -d delim    timestamp follows the first delim on each line"
+            << std::endl
+            << "              (default: timestamp starts the line)" << std::endl;
+  std::exit(2);
+}
+
+} // namespace
+
+// function:  main
+// params:    see usage()
+// purpose:   maps the input, hands the chunks out to the workers, and writes
+//            the converted chunks in order as they finish.
+//
+int main(int argc, char* argv[])
+{
+  unsigned int threads = std::thread::hardware_concurrency();
+  char delim = 0;
+  int arg = 1;
+  for ( ; arg < argc && argv[arg][0] == '-' && argv[arg][1]; ++arg) {
+    if (!std::strcmp(argv[arg], "-t") && arg + 1 < argc)
+      threads = std::atoi(argv[++arg]);
+    else if (!std::strcmp(argv[arg], "-d") && arg + 1 < argc)
+      delim = argv[++arg][0];
+    else
+      usage();
+  }
+  if (argc - arg < 3 || argc - arg > 4)
+    usage();
+  if (threads == 0)
+    threads = 1;
+
+  const char* infmt = argv[arg];
+  const DateFormatter in(infmt), out(argv[arg + 1]);
+  Job job;
+  job.in = &in;
+  job.out = &out;
+  job.delim = delim;
+  const char* inpath = argv[arg + 2];
+
+  std::FILE* output = stdout;
+  if (argc - arg == 4 && !(output = std::fopen(argv[arg + 3], "wb"))) {
+    std::perror(argv[arg + 3]);
+    return 1;
+  }
+
+  int fd = ::open(inpath, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || ::fstat(fd, &st) != 0) {
+    std::perror(inpath);
+    return 1;
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  const char* data = 0;
+  if (size) {
+    void* map = ::mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      std::perror(inpath);
+      return 1;
+    }
+    ::madvise(map, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(map);
+  }
+  ::close(fd);
+
+  // Make sure the input format can read back what it writes before
+  // starting, so a bad format is one error rather than a failure per line.
+  try {
+    in.parse(in.format(DateTime(2000, 1, 1, 13, 0, 0)));
+  }
+  catch (const std::exception&) {
+    std::cerr << "reformat: can't parse with format '" << infmt << "'"
+              << std::endl;
+    return 1;
+  }
+
+  // Cut the file into chunks that end just after a newline.
+  for (size_t pos = 0; pos < size; ) {
+    size_t end = pos + CHUNK_BYTES < size ? pos + CHUNK_BYTES : size;
+    if (end < size) {
+      const char* nl = static_cast<const char*>(
+        std::memchr(data + end, '\n', size - end));
+      end = nl ? (nl - data) + 1 : size;
+    }
+    Chunk chunk = { data + pos, data + end, std::string(), 0, 0, false };
+    job.chunks.push_back(chunk);
+    pos = end;
+  }
+
+  // Each worker starts out owning a contiguous run of chunks.
+  if (threads > job.chunks.size() && !job.chunks.empty())
+    threads = job.chunks.size();
+  job.queues = std::vector<WorkQueue>(threads);
+  for (size_t c = 0; c < job.chunks.size(); ++c)
+    job.queues[c * threads / job.chunks.size()].push(c);
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < threads; ++t)
+    pool.push_back(std::thread(worker, std::ref(job), t));
+
+  unsigned long long lines = 0, failures = 0;
+  bool ok = true;
+  for (size_t c = 0; c < job.chunks.size(); ++c) {
+    Chunk& chunk = job.chunks[c];
+    {
+      std::unique_lock<std::mutex> lock(job.doneMutex);
+      job.doneCond.wait(lock, [&chunk] { return chunk.done; });
+    }
+    if (std::fwrite(chunk.output.data(), 1, chunk.output.size(), output)
+        != chunk.output.size())
+      ok = false;
+    std::string().swap(chunk.output);
+    lines += chunk.lines;
+    failures += chunk.failures;
+  }
+  for (size_t t = 0; t < pool.size(); ++t)
+    pool[t].join();
+  if (std::fflush(output) != 0 || (output != stdout && std::fclose(output) != 0))
+    ok = false;
+
+  const double secs = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - begin).count();
+  std::cerr << "reformat: " << lines << " lines, " << size << " bytes, "
+            << failures << " unconverted, " << threads << " threads, "
+            << secs << " s" << std::endl
+            << "reformat: " << (secs > 0 ? lines / secs : 0) << " lines/s, "
+            << (secs > 0 ? size / secs / (1024 * 1024) : 0) << " MiB/s"
+            << std::endl;
+
+  if (data)
+    ::munmap(const_cast<char*>(data), size);
+  if (!ok) {
+    std::perror("reformat: write failed");
+    return 1;
+  }
+  return 0;
+}
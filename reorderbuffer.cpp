@@ -0,0 +1,178 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "reorderbuffer.h"
+
+#include <algorithm>
+
+namespace dragonfly {
+
+namespace {
+  // Rounds towards negative infinity, unlike '/'.
+  inline long long sliceOf(const packedtime_t when, const packedtime_t slice)
+  { return when / slice - (when % slice < 0); }
+
+  inline bool earlierEvent(const TimedEvent& a, const TimedEvent& b)
+  { return a.time < b.time; }
+
+  // Moves an insertion sort may make per event before the bucket's taken
+  // to be shuffled rather than nearly in order.
+  const size_t SORT_MOVES_PER_EVENT = 8;
+
+  // Stable.  Insertion sort, which is linear for events that are already
+  // nearly in order; once it's made more than a few moves per event it
+  // hands the rest over to std::stable_sort, so a shuffled bucket costs
+  // n log n rather than n^2.  The part insertion sorted keeps equal times
+  // in push order, so stable_sort does too.
+  void sortSlice(TimedEvent* events, const size_t n)
+  {
+    size_t budget = n * SORT_MOVES_PER_EVENT;
+    for (size_t i = 1; i < n; ++i) {
+      const TimedEvent e = events[i];
+      size_t j = i;
+      for (; j > 0 && events[j - 1].time > e.time; --j)
+        events[j] = events[j - 1];
+      events[j] = e;
+      const size_t moved = i - j;
+      if (moved > budget) {
+        std::stable_sort(events, events + n, earlierEvent);
+        return;
+      }
+      budget -= moved;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+ReorderBuffer::ReorderBuffer(const Duration& lateness, const Duration& slice)
+  : lateness_(lateness.packed()), slice_(slice.packed()), mask_(0), late_(0),
+    latest_(0), readyCopy_(NONE), consumedCopy_(NONE), ready_(NONE),
+    consumed_(NONE)
+{
+  if (slice_ <= 0 || lateness_ < 0)
+    throw DateValueOutOfRangeException();
+  // Room for the lateness, the slice the watermark is in, and as much
+  // again for poll() to fall behind by.
+  const long long needed = 2 * (lateness_ / slice_ + 2);
+  size_t buckets = 1;
+  while (static_cast<long long>(buckets) < needed)
+    buckets *= 2;
+  buckets_.resize(buckets);
+  mask_ = buckets - 1;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const ReorderStatus ReorderBuffer::push(const DateTime& when, void* data)
+{
+  return push(when.packed(), data);
+}
+
+// function:  push
+// purpose:   The producer's side.  Moves the watermark first, so a new
+//            latest time completes the slices behind it even if the event
+//            itself doesn't fit yet.
+//
+DFLY_INLINE
+const ReorderStatus ReorderBuffer::push(const packedtime_t when, void* data)
+{
+  if (readyCopy_ == NONE) {
+    // The first event starts the clock; consumed_ is written before ready_
+    // is published, and poll() doesn't look at it until then.
+    latest_ = when;
+    readyCopy_ = consumedCopy_ = sliceOf(when - lateness_, slice_);
+    consumed_.store(readyCopy_, std::memory_order_relaxed);
+    ready_.store(readyCopy_, std::memory_order_release);
+  }
+
+  const long long s = sliceOf(when, slice_);
+  if (s < readyCopy_) {
+    late_.fetch_add(1, std::memory_order_relaxed);
+    return REORDER_LATE;
+  }
+  if (when > latest_) {
+    latest_ = when;
+    const long long ready = sliceOf(when - lateness_, slice_);
+    if (ready > readyCopy_) {
+      readyCopy_ = ready;
+      ready_.store(ready, std::memory_order_release);
+    }
+  }
+
+  const long long room = static_cast<long long>(buckets_.size());
+  if (s >= consumedCopy_ + room) {
+    consumedCopy_ = consumed_.load(std::memory_order_acquire);
+    if (s >= consumedCopy_ + room)
+      return REORDER_FULL;
+  }
+  const TimedEvent e = { when, data };
+  buckets_[static_cast<size_t>(s) & mask_].push_back(e);
+  return REORDER_ACCEPTED;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const size_t ReorderBuffer::poll(ReorderCallback callback, void* user)
+{
+  const long long ready = ready_.load(std::memory_order_acquire);
+  if (ready == NONE)
+    return 0;
+  const long long consumed = consumed_.load(std::memory_order_relaxed);
+  if (ready <= consumed)
+    return 0;
+  const size_t n = emit(consumed, ready, callback, user);
+  consumed_.store(ready, std::memory_order_release);
+  return n;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const size_t ReorderBuffer::flush(ReorderCallback callback, void* user)
+{
+  if (readyCopy_ == NONE)
+    return 0;
+  readyCopy_ = sliceOf(latest_, slice_) + 1;
+  ready_.store(readyCopy_, std::memory_order_release);
+  return poll(callback, user);
+}
+
+// function:  emit
+// purpose:   Only the ring's worth of slices after from can hold anything:
+//            push() won't go further ahead of consumed_ than that.
+//
+DFLY_INLINE
+const size_t ReorderBuffer::emit(const long long from, const long long to,
+                                 ReorderCallback callback, void* user)
+{
+  const long long room = static_cast<long long>(buckets_.size());
+  const long long end = to - from > room ? from + room : to;
+  size_t n = 0;
+  for (long long s = from; s < end; ++s) {
+    std::vector<TimedEvent>& bucket = buckets_[static_cast<size_t>(s) & mask_];
+    if (bucket.empty())
+      continue;
+    if (slice_ > 1)
+      sortSlice(&bucket[0], bucket.size());
+    if (callback)
+      callback(&bucket[0], bucket.size(), user);
+    n += bucket.size();
+    bucket.clear();
+  }
+  return n;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const DateTime ReorderBuffer::watermark() const
+{
+  const long long ready = ready_.load(std::memory_order_acquire);
+  DateTime d;
+  if (ready != NONE && ready > 0)
+    d.packed(ready * slice_);
+  return d;
+}
+
+} // namespace dragonfly
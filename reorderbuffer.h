@@ -0,0 +1,124 @@
+#ifndef __REORDERBUFFER_H__
+#define __REORDERBUFFER_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "datetime.h"
+#include "duration.h"
+#include "datetypes.h"
+#include "dateexception.h"
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <climits>
+
+namespace dragonfly {
+
+// struct:  TimedEvent
+// purpose: An event as it goes through a ReorderBuffer.
+//
+struct TimedEvent {
+  packedtime_t time;
+  void* data;               // as passed to push()
+};
+
+// Called by poll() with events in time order, a slice at a time; equal
+// times come out in the order they were pushed.
+typedef void (*ReorderCallback)(const TimedEvent* events, size_t n,
+                                void* user);
+
+enum ReorderStatus {
+  REORDER_ACCEPTED,
+  REORDER_LATE,             // behind the watermark; dropped and counted
+  REORDER_FULL              // too far ahead of what poll() has emitted
+};
+
+// class:   ReorderBuffer
+// purpose: Puts events that arrive slightly out of order back in time
+//          order.
+//
+//          The watermark is the latest time pushed so far, less the
+//          allowed lateness: nothing older is expected any more, so
+//          everything before it can go downstream, and anything older that
+//          does turn up is dropped as late.  Events are kept in a ring of
+//          buckets, one per slice of time, so push() is an append and
+//          poll() walks the buckets the watermark has passed and hands each
+//          one over -- no heap.  The watermark moves a slice at a time,
+//          which lets events in up to one slice later than the lateness.
+//          With a one-tick slice the events in a bucket all have the same
+//          time and go out as they are; with wider slices each bucket is
+//          insertion sorted first, which costs next to nothing for events
+//          that are nearly in order already, and falls back to
+//          std::stable_sort for a bucket that turns out to be shuffled.
+//
+//          The ring holds twice the lateness, so poll() can fall behind by
+//          up to the lateness before push() returns REORDER_FULL.  An event
+//          that far ahead still moves the watermark: poll() and push it
+//          again and it goes in.
+//
+//          One thread may push() while another polls, with no locks: each
+//          bucket belongs to one side or the other, and they hand buckets
+//          over through two atomic slice counts.  Everything else, flush()
+//          included, is for when only one thread is using the buffer.
+//
+class ReorderBuffer {
+  public:
+    // Throws DateValueOutOfRangeException if slice isn't positive or
+    // lateness is negative.
+    ReorderBuffer(const Duration& lateness, const Duration& slice);
+
+  public:
+    const ReorderStatus push(const DateTime& when, void* data = 0);
+    const ReorderStatus push(const packedtime_t when, void* data = 0);
+
+    // Emits every event the watermark has passed.  Returns how many.
+    const size_t poll(ReorderCallback callback, void* user = 0);
+    // Emits everything still held, as at the end of the stream.  That
+    // moves the watermark to the end of the slice holding the latest time
+    // so far, so anything pushed afterwards that falls in that slice or
+    // before it is late, even if it's after the latest time itself.
+    const size_t flush(ReorderCallback callback, void* user = 0);
+
+  public:
+    const unsigned long long late() const
+    { return late_.load(std::memory_order_relaxed); }
+    // Everything before this has been emitted or is ready to be; 0 A.D.
+    // before the first push().
+    const DateTime watermark() const;
+
+  private:
+    ReorderBuffer(const ReorderBuffer&);
+    ReorderBuffer& operator= (const ReorderBuffer&);
+
+    static constexpr long long NONE = LLONG_MIN;
+
+    // Emits the buckets for slices [from, to).
+    const size_t emit(const long long from, const long long to,
+                      ReorderCallback callback, void* user);
+
+  private:
+    packedtime_t lateness_;
+    packedtime_t slice_;
+    size_t mask_;                       // buckets_.size() - 1
+    std::vector<std::vector<TimedEvent> > buckets_;
+    std::atomic<unsigned long long> late_;
+
+    // The producer's: the latest time pushed, and its copies of ready_ and
+    // consumed_.
+    alignas(64) packedtime_t latest_;
+    long long readyCopy_;
+    long long consumedCopy_;
+    // Slices before ready_ are complete, and the producer is done with
+    // their buckets.  NONE before the first push.
+    alignas(64) std::atomic<long long> ready_;
+    // Slices before consumed_ have been emitted, and their buckets are the
+    // producer's again.
+    alignas(64) std::atomic<long long> consumed_;
+};
+
+} // namespace dragonfly
+
+#endif //__REORDERBUFFER_H__
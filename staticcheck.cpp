@@ -0,0 +1,126 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// staticcheck: checks StaticDateFormatter against DateFormatter.  Needs
+// C++20; "make staticcheck" builds and runs it.
+//
+// For each pattern, formats a spread of dates from 1000 to 9999 both
+// ways, and where the pattern can be parsed, parses the text back both
+// ways too.  Prints each mismatch to stderr, and exits non-zero if there
+// were any.
+
+#include "dflydate.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if __cplusplus < 202002L
+#error "staticcheck needs C++20"
+#endif
+
+using namespace dragonfly;
+
+namespace {
+
+int g_failures = 0;
+
+// function:  report
+// purpose:   Notes one mismatch.
+//
+void report(const char* pattern, const DateTime& date, const char* what,
+            const std::string& expected, const std::string& got)
+{
+  ++g_failures;
+  std::cerr << pattern << ": " << what << " of day " << date.days()
+            << ": expected \"" << expected << "\", got \"" << got << "\""
+            << std::endl;
+}
+
+// function:  dates
+// returns:   a spread of dates and times of day, 1000 through 9999.
+//
+std::vector<DateTime> dates()
+{
+  std::vector<DateTime> result;
+  DateTime d;
+  d.set(1000, 1, 1);
+  const datecount_t last = DateTime(9999, 12, 31).days();
+  for (int i = 0; d.days() <= last; ++i) {
+    d.time(i % 24, i * 7 % 60, i * 13 % 60);
+    result.push_back(d);
+    d.days(d.days() + 1 + i % 29);
+  }
+  // Month and year ends, and the times either side of noon and midnight.
+  const int years[] = { 1000, 1900, 1999, 2000, 2024, 2100, 9999 };
+  for (size_t y = 0; y < sizeof(years) / sizeof(years[0]); ++y) {
+    for (int m = 1; m <= 12; ++m) {
+      d.set(years[y], m, 1);
+      d.time(0, 0, 0);
+      result.push_back(d);
+      d.time(12, 59, 59);
+      result.push_back(d);
+      d.days(d.days() - 1);
+      d.time(23, 59, 59);
+      if (d.year() >= 1000)
+        result.push_back(d);
+    }
+  }
+  return result;
+}
+
+// function:  checkFormat
+// purpose:   Compares both formatters' output for every date.
+//
+template <class Static>
+void checkFormat(const std::vector<DateTime>& all)
+{
+  const DateFormatter dynamic(Static::pattern());
+  for (size_t i = 0; i < all.size(); ++i) {
+    const std::string expected = dynamic.format(all[i]);
+    const std::string got = Static::format(all[i]);
+    if (got != expected || got.size() != Static::LENGTH)
+      report(Static::pattern(), all[i], "format", expected, got);
+  }
+}
+
+// function:  checkParse
+// purpose:   Formats every date and parses it back with both formatters.
+//
+template <class Static>
+void checkParse(const std::vector<DateTime>& all)
+{
+  checkFormat<Static>(all);
+  const DateFormatter dynamic(Static::pattern());
+  for (size_t i = 0; i < all.size(); ++i) {
+    const std::string text = Static::format(all[i]);
+    const DateTime expected = dynamic.parse(text);
+    const DateTime got = Static::parse(text);
+    if (got.packed() != expected.packed())
+      report(Static::pattern(), all[i], "parse", dynamic.format(expected),
+             dynamic.format(got));
+  }
+}
+
+}
+
+int main()
+{
+  const std::vector<DateTime> all = dates();
+
+  checkParse<StaticDateFormatter<"%Y-%m-%d %H:%M:%S"> >(all);
+  checkParse<StaticDateFormatter<"%Y%m%dT%H%M%S"> >(all);
+  checkParse<StaticDateFormatter<"%d/%m/%y %k:%M"> >(all);
+  checkParse<StaticDateFormatter<"%e.%m.%Y, 100%% at %H"> >(all);
+  checkFormat<StaticDateFormatter<"%C %j %w %I %l"> >(all);
+
+  if (g_failures) {
+    std::cerr << g_failures << " mismatches" << std::endl;
+    return 1;
+  }
+  std::cout << "StaticDateFormatter matches DateFormatter on " << all.size()
+            << " dates" << std::endl;
+  return 0;
+}
@@ -0,0 +1,385 @@
+#ifndef __STATICDATEFORMATTER_H__
+#define __STATICDATEFORMATTER_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// StaticDateFormatter: a DateFormatter whose pattern is a template
+// argument, for the usual case where the pattern is a string literal.
+//
+//   typedef StaticDateFormatter<"%Y-%m-%d %H:%M:%S"> Stamp;
+//   char buf[Stamp::LENGTH];
+//   Stamp::format(now, buf);                  // always 19 characters
+//   DateTime t = Stamp::parse(text);
+//
+// The pattern is broken down while compiling, and a tag that's unknown or
+// not supported is a compile error rather than a DateBadFormatElement at
+// run time.  Formatting and parsing are unrolled, one step per element of
+// the pattern, with every output position a constant.  Only the tags whose
+// width is fixed are supported, which leaves out the locale's names and
+// AM/PM strings:
+//
+//   %%  %C  %d  %e  %H  %I  %j  %k  %l  %m  %M  %S  %w  %y  %Y
+//
+// They mean what they mean to DateFormatter, with one difference: %Y is
+// always four digits, zero padded, so years before 1000 come out as 0999
+// rather than 999, and a year past 9999 throws DateValueOutOfRangeException.
+// parse() also rejects, at compile time, the tags that DateFormatter::parse
+// can't turn back into a date: %C, %I, %l (there's no %p), %j and %w.
+//
+// parse() reads exactly LENGTH characters -- what format() writes.  Fields
+// are converted with Convert in strict mode, so each must be its full width
+// (blank padding is fine), and a space in the pattern matches exactly one
+// whitespace character.  Otherwise it behaves like DateFormatter::parse:
+// a mismatched literal throws DateBadFormatElement, and fields missing
+// from the pattern are left at zero, so the pattern needs a full date.
+//
+// Needs C++20 (class-type template arguments); under an earlier standard
+// this header is empty.
+
+#include "datetime.h"
+#include "dateexception.h"
+#include "dateformatter.h"
+
+#if __cplusplus >= 202002L
+
+#include <array>
+#include <string>
+#include <utility>
+#include <cstddef>
+
+namespace dragonfly {
+
+// struct:  DatePattern<N>
+// purpose: Holds a string literal so it can be a template argument.
+//
+template <size_t N>
+struct DatePattern {
+  constexpr DatePattern(const char (&s)[N])
+  { for (size_t i = 0; i < N; ++i) text[i] = s[i]; }
+  char text[N];
+};
+
+// class:   StaticDateFormatterBase
+// purpose: The parts of StaticDateFormatter that don't depend on the
+//          pattern.
+//
+class StaticDateFormatterBase {
+  protected:
+    // One element of a pattern: a literal character (tag 0), whitespace
+    // (tag ' '), or a field.
+    struct Element {
+      char tag;
+      char literal;
+      unsigned int width;
+    };
+
+    static constexpr int WRAP = DateFormatter::WRAP_;
+
+    // Width of a field tag, or 0 if it isn't one StaticDateFormatter does.
+    static constexpr unsigned int fieldWidth(const char tag)
+    {
+      switch (tag) {
+        case 'Y': return 4;
+        case 'j': return 3;
+        case 'w': return 1;
+        case 'C': case 'd': case 'e': case 'H': case 'I': case 'k':
+        case 'l': case 'm': case 'M': case 'S': case 'y':
+          return 2;
+        default:
+          return 0;
+      }
+    }
+
+    static constexpr bool isSpace(const char c)
+    { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    // function:  countElements
+    // returns:   how many elements the pattern has, or -1 if it has a tag
+    //            that isn't supported (or a % at the very end).
+    //
+    template <size_t N>
+    static constexpr int countElements(const DatePattern<N>& p)
+    {
+      int count = 0;
+      for (size_t i = 0; i + 1 < N; ++i, ++count) {
+        if (p.text[i] != '%')
+          continue;
+        if (i + 2 >= N)
+          return -1;
+        ++i;
+        if (p.text[i] != '%' && fieldWidth(p.text[i]) == 0)
+          return -1;
+      }
+      return count;
+    }
+
+    template <size_t M, size_t N>
+    static constexpr std::array<Element, M> elements(const DatePattern<N>& p)
+    {
+      std::array<Element, M> result{};
+      size_t e = 0;
+      for (size_t i = 0; i + 1 < N && e < M; ++i, ++e) {
+        Element el = { 0, p.text[i], 1 };
+        if (isSpace(p.text[i]))
+          el.tag = ' ';
+        else if (p.text[i] == '%') {
+          ++i;
+          if (p.text[i] == '%')
+            el.literal = '%';
+          else {
+            el.tag = p.text[i];
+            el.width = fieldWidth(p.text[i]);
+          }
+        }
+        result[e] = el;
+      }
+      return result;
+    }
+
+    // "00" to "99", for writing two digits at a time.
+    static constexpr char DIGIT_PAIRS[201] =
+      "00010203040506070809101112131415161718192021222324252627282930313233"
+      "34353637383940414243444546474849505152535455565758596061626364656667"
+      "6869707172737475767778798081828384858687888990919293949596979899";
+
+    static void put2(char* out, const int v)
+    {
+      out[0] = DIGIT_PAIRS[2 * v];
+      out[1] = DIGIT_PAIRS[2 * v + 1];
+    }
+    static void put2Blank(char* out, const int v)
+    {
+      put2(out, v);
+      if (v < 10)
+        out[0] = ' ';
+    }
+};
+
+// class:   StaticDateFormatter<pattern>
+// purpose: See the top of the file.  Everything's static; an instance can
+//          be made, for symmetry with DateFormatter, but holds nothing.
+//
+template <DatePattern Pattern>
+class StaticDateFormatter : private StaticDateFormatterBase {
+  private:
+    static constexpr int COUNT = countElements(Pattern);
+    static_assert(COUNT >= 0, "StaticDateFormatter: the pattern has a tag "
+                  "that isn't fixed width (names, AM/PM) or isn't a tag at "
+                  "all; use DateFormatter for it");
+
+    static constexpr size_t SIZE = COUNT > 0 ? COUNT : 1;
+    static constexpr std::array<Element, SIZE> ELEMENTS =
+      elements<SIZE>(Pattern);
+
+    static constexpr std::array<size_t, SIZE + 1> offsets()
+    {
+      std::array<size_t, SIZE + 1> at{};
+      for (int i = 0; i < COUNT; ++i)
+        at[i + 1] = at[i] + ELEMENTS[i].width;
+      return at;
+    }
+    static constexpr std::array<size_t, SIZE + 1> OFFSETS = offsets();
+
+    static constexpr bool uses(const char tag)
+    {
+      for (int i = 0; i < COUNT; ++i)
+        if (ELEMENTS[i].tag == tag)
+          return true;
+      return false;
+    }
+
+  public:
+    // Characters format() writes and parse() reads.
+    static constexpr size_t LENGTH = OFFSETS[COUNT];
+
+  public:
+    // Writes exactly LENGTH characters to out, with no terminating NUL.
+    static size_t format(const DateTime& date, char* out);
+    static const std::string format(const DateTime& date);
+
+  public:
+    // text must hold at least LENGTH characters (DateParsingException if
+    // not); the ones after are ignored.
+    static const DateTime parse(const char* text, const size_t length);
+    static const DateTime parse(const std::string& text)
+    { return parse(text.data(), text.size()); }
+
+  public:
+    static const char* pattern() { return Pattern.text; }
+
+  private:
+    // The calendar fields the pattern needs, each worked out once.
+    struct Fields {
+      int year, month, day, dayOfYear, dayOfWeek, hour, minute, second;
+    };
+    // The fields parse() has read.
+    struct Parsed {
+      int year, month, day, hour, minute, second;
+    };
+
+    template <size_t I>
+    static void put(const Fields& f, char* out);
+    template <size_t I>
+    static void get(const char* text, const size_t length, Parsed& p);
+
+    template <size_t... I>
+    static void putAll(const Fields& f, char* out, std::index_sequence<I...>)
+    { (put<I>(f, out), ...); }
+    template <size_t... I>
+    static void getAll(const char* text, const size_t length, Parsed& p,
+                       std::index_sequence<I...>)
+    { (get<I>(text, length, p), ...); }
+};
+
+//-----------------------------------------------------------------------------
+template <DatePattern Pattern>
+inline size_t StaticDateFormatter<Pattern>::format(const DateTime& date,
+                                                   char* out)
+{
+  Fields f = {};
+  if constexpr (uses('Y') || uses('C') || uses('y'))
+    f.year = date.year();
+  if constexpr (uses('Y')) {
+    if (f.year < 0 || f.year > 9999) {
+      DFLY_COUNT(EXCEPTIONS);
+      throw DateValueOutOfRangeException();
+    }
+  }
+  if constexpr (uses('m'))
+    f.month = date.month();
+  if constexpr (uses('d') || uses('e'))
+    f.day = date.day();
+  if constexpr (uses('j'))
+    f.dayOfYear = date.dayOfYear();
+  if constexpr (uses('w'))
+    f.dayOfWeek = date.dayOfWeek();
+  if constexpr (uses('H') || uses('I') || uses('k') || uses('l'))
+    f.hour = date.hour();
+  if constexpr (uses('M'))
+    f.minute = date.minute();
+  if constexpr (uses('S'))
+    f.second = date.second();
+
+  putAll(f, out, std::make_index_sequence<COUNT>());
+  return LENGTH;
+}
+
+//-----------------------------------------------------------------------------
+template <DatePattern Pattern>
+inline const std::string StaticDateFormatter<Pattern>::format(
+  const DateTime& date)
+{
+  char text[LENGTH + 1];
+  format(date, text);
+  return std::string(text, LENGTH);
+}
+
+//-----------------------------------------------------------------------------
+template <DatePattern Pattern>
+template <size_t I>
+inline void StaticDateFormatter<Pattern>::put(const Fields& f, char* out)
+{
+  constexpr Element e = ELEMENTS[I];
+  char* at = out + OFFSETS[I];
+  if constexpr (e.tag == 0 || e.tag == ' ')
+    *at = e.literal;
+  else if constexpr (e.tag == 'Y') {
+    put2(at, f.year / 100);
+    put2(at + 2, f.year % 100);
+  }
+  else if constexpr (e.tag == 'C')
+    put2(at, f.year / 100 % 100);
+  else if constexpr (e.tag == 'y')
+    put2(at, f.year % 100);
+  else if constexpr (e.tag == 'm')
+    put2(at, f.month);
+  else if constexpr (e.tag == 'd')
+    put2(at, f.day);
+  else if constexpr (e.tag == 'e')
+    put2Blank(at, f.day);
+  else if constexpr (e.tag == 'j') {
+    at[0] = static_cast<char>('0' + f.dayOfYear / 100);
+    put2(at + 1, f.dayOfYear % 100);
+  }
+  else if constexpr (e.tag == 'w')
+    *at = static_cast<char>('0' + f.dayOfWeek);
+  else if constexpr (e.tag == 'H')
+    put2(at, f.hour);
+  else if constexpr (e.tag == 'k')
+    put2Blank(at, f.hour);
+  else if constexpr (e.tag == 'I')
+    put2(at, f.hour % 12 ? f.hour % 12 : 12);
+  else if constexpr (e.tag == 'l')
+    put2Blank(at, f.hour % 12 ? f.hour % 12 : 12);
+  else if constexpr (e.tag == 'M')
+    put2(at, f.minute);
+  else if constexpr (e.tag == 'S')
+    put2(at, f.second);
+}
+
+//-----------------------------------------------------------------------------
+template <DatePattern Pattern>
+inline const DateTime StaticDateFormatter<Pattern>::parse(const char* text,
+                                                          const size_t length)
+{
+  static_assert(!uses('C') && !uses('I') && !uses('l') && !uses('j') &&
+                !uses('w'), "StaticDateFormatter::parse: %C, %I, %l, %j and "
+                "%w can't be parsed back into a date");
+  if (length < LENGTH) {
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateParsingException();
+  }
+  Parsed p = {};
+  getAll(text, length, p, std::make_index_sequence<COUNT>());
+  return DateTime(p.year, p.month, p.day, p.hour, p.minute, p.second);
+}
+
+//-----------------------------------------------------------------------------
+template <DatePattern Pattern>
+template <size_t I>
+inline void StaticDateFormatter<Pattern>::get(const char* text,
+                                              const size_t length, Parsed& p)
+{
+  constexpr Element e = ELEMENTS[I];
+  const char* at = text + OFFSETS[I];
+  // Convert reads no further than its width anyway, but knowing there's
+  // more text after lets it load eight bytes at once.
+  const size_t w = length - OFFSETS[I];
+  if constexpr (e.tag == 0) {
+    if (*at != e.literal) {
+      DFLY_COUNT(EXCEPTIONS);
+      throw DateBadFormatElement();
+    }
+  }
+  else if constexpr (e.tag == ' ') {
+    if (!isSpace(*at)) {
+      DFLY_COUNT(EXCEPTIONS);
+      throw DateBadFormatElement();
+    }
+  }
+  else if constexpr (e.tag == 'Y')
+    Convert<4,0,9999>::get(at, w, p.year, CONVERT_STRICT);
+  else if constexpr (e.tag == 'y') {
+    Convert<2,0,99>::get(at, w, p.year, CONVERT_STRICT);
+    p.year += p.year < WRAP ? 2000 : 1900;
+  }
+  else if constexpr (e.tag == 'm')
+    Convert<2,1,12>::get(at, w, p.month, CONVERT_STRICT);
+  else if constexpr (e.tag == 'd' || e.tag == 'e')
+    Convert<2,1,31>::get(at, w, p.day, CONVERT_STRICT);
+  else if constexpr (e.tag == 'H' || e.tag == 'k')
+    Convert<2,0,23>::get(at, w, p.hour, CONVERT_STRICT);
+  else if constexpr (e.tag == 'M')
+    Convert<2,0,59>::get(at, w, p.minute, CONVERT_STRICT);
+  else if constexpr (e.tag == 'S')
+    Convert<2,0,59>::get(at, w, p.second, CONVERT_STRICT);
+}
+
+} // namespace dragonfly
+
+#endif // __cplusplus >= 202002L
+
+#endif //__STATICDATEFORMATTER_H__
@@ -0,0 +1,71 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "stopwatch.h"
+
+#ifdef DFLY_HAVE_RDTSC
+#include <cpuid.h>
+#endif
+
+namespace dragonfly {
+
+namespace {
+  inline uint64_t monotonicNanos()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const StopwatchClock& StopwatchClock::get()
+{
+  static const StopwatchClock clock;
+  return clock;
+}
+
+// function:  StopwatchClock
+// purpose:   Uses the TSC if CPUID says it's invariant and it ran at a
+//            believable rate (0.1 to 100 GHz) against CLOCK_MONOTONIC over
+//            10ms; otherwise clock_gettime, one tick a nanosecond.
+//
+DFLY_INLINE
+StopwatchClock::StopwatchClock()
+  : tsc_(false), nanosPerTick_(static_cast<uint64_t>(1) << 32)
+{
+#ifdef DFLY_HAVE_RDTSC
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8)))
+    return;
+
+  const uint64_t CALIBRATION_NANOS = 10000000;
+  const uint64_t startNanos = monotonicNanos();
+  const uint64_t startTicks = __rdtsc();
+  uint64_t nanos, ticks;
+  do {
+    nanos = monotonicNanos() - startNanos;
+    ticks = __rdtsc() - startTicks;
+  } while (nanos < CALIBRATION_NANOS);
+
+  if (ticks < nanos / 10 || ticks / 100 > nanos)
+    return;
+  nanosPerTick_ = static_cast<uint64_t>(
+    (static_cast<unsigned __int128>(nanos) << 32) / ticks);
+  tsc_ = true;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const Duration StopwatchClock::toDuration(const uint64_t ticks) const
+{
+  EpochCounter e;
+  e.packed(static_cast<packedtime_t>(toNanos(ticks) / 1000000));
+  return Duration(e);
+}
+
+} // namespace dragonfly
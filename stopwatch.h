@@ -0,0 +1,186 @@
+#ifndef __STOPWATCH_H__
+#define __STOPWATCH_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Timing code with a monotonic, high-resolution clock, cheaply enough to
+// leave it on in hot paths.
+//
+// On x86 with an invariant TSC (one that ticks at a constant rate whatever
+// the core's frequency or power state, as on every x86 server of the last
+// decade or so) the clock is the TSC, read with rdtsc: twenty-odd cycles
+// and no system call.  Its rate is measured against CLOCK_MONOTONIC the
+// first time a clock is needed, which takes 10ms; call
+// StopwatchClock::get() at startup to get that out of the way.  Anywhere
+// else the clock is clock_gettime(CLOCK_MONOTONIC), in nanoseconds.
+//
+// Stopwatches and accumulators keep raw clock ticks, and only turn them
+// into nanoseconds or Durations when they're read.  rdtsc isn't
+// serializing, so sections shorter than a few dozen nanoseconds can be
+// blurred by out-of-order execution around them.
+
+#include "duration.h"
+#include "datetypes.h"
+#include "durationhistogram.h"
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DFLY_HAVE_RDTSC 1
+#endif
+
+namespace dragonfly {
+
+// class:   StopwatchClock
+// purpose: The clock every Stopwatch reads, and the rate to convert its
+//          ticks at.
+//
+class StopwatchClock {
+  public:
+    // Calibrated on the first call; thread safe.
+    static const StopwatchClock& get();
+
+  public:
+    const uint64_t now() const;
+    const uint64_t toNanos(const uint64_t ticks) const
+    { return static_cast<uint64_t>(
+        static_cast<unsigned __int128>(ticks) * nanosPerTick_ >> 32); }
+    const Duration toDuration(const uint64_t ticks) const;
+
+    // Whether the clock is the TSC, rather than clock_gettime.
+    const bool tsc() const { return tsc_; }
+    // Ticks per second.
+    const double frequency() const
+    { return 4294967296.0 * 1e9 / static_cast<double>(nanosPerTick_); }
+
+  private:
+    StopwatchClock();
+
+  private:
+    bool tsc_;
+    uint64_t nanosPerTick_;     // as a 32.32 fixed-point number
+};
+
+// class:   Stopwatch
+// purpose: Elapsed time since it was started.
+//
+class Stopwatch {
+  public:
+    // Starts running straight away.
+    Stopwatch() : clock_(StopwatchClock::get()), begin_(clock_.now()) {}
+
+  public:
+    void restart() { begin_ = clock_.now(); }
+    // Returns the time so far and starts again from now, for timing one
+    // step after another.
+    const uint64_t lapTicks();
+
+  public:
+    const uint64_t elapsedTicks() const { return clock_.now() - begin_; }
+    const uint64_t elapsedNanos() const
+    { return clock_.toNanos(elapsedTicks()); }
+    // Rounded down to a whole millisecond tick.
+    const Duration elapsed() const
+    { return clock_.toDuration(elapsedTicks()); }
+
+  private:
+    const StopwatchClock& clock_;
+    uint64_t begin_;
+};
+
+// class:   StopwatchTotal
+// purpose: How many times a section ran and how long it took altogether,
+//          fed by ScopedTimer.  Not thread safe; keep one per thread and
+//          merge() them.
+//
+class StopwatchTotal {
+  public:
+    StopwatchTotal() : clock_(StopwatchClock::get()), count_(0), ticks_(0) {}
+
+  public:
+    void add(const uint64_t ticks) { ++count_; ticks_ += ticks; }
+    void merge(const StopwatchTotal& other)
+    { count_ += other.count_; ticks_ += other.ticks_; }
+    void reset() { count_ = ticks_ = 0; }
+
+  public:
+    const uint64_t count() const { return count_; }
+    const uint64_t totalNanos() const { return clock_.toNanos(ticks_); }
+    const Duration total() const { return clock_.toDuration(ticks_); }
+    // 0 if the section hasn't run.
+    const double meanNanos() const
+    { return count_ ? static_cast<double>(totalNanos()) / count_ : 0.0; }
+
+  private:
+    const StopwatchClock& clock_;
+    uint64_t count_;
+    uint64_t ticks_;
+};
+
+// class:   ScopedTimer
+// purpose: Times the scope it's declared in and adds it to a total, or
+//          records it in a DurationHistogram, on the way out.
+//
+//            {
+//              ScopedTimer timer(parseTime);
+//              ...
+//            }
+//
+class ScopedTimer {
+  public:
+    explicit ScopedTimer(StopwatchTotal& total)
+      : clock_(StopwatchClock::get()), total_(&total), histogram_(0),
+        begin_(clock_.now()) {}
+    explicit ScopedTimer(DurationHistogram& histogram)
+      : clock_(StopwatchClock::get()), total_(0), histogram_(&histogram),
+        begin_(clock_.now()) {}
+    ~ScopedTimer();
+
+  private:
+    ScopedTimer(const ScopedTimer&);
+    ScopedTimer& operator= (const ScopedTimer&);
+
+  private:
+    const StopwatchClock& clock_;
+    StopwatchTotal* total_;
+    DurationHistogram* histogram_;
+    const uint64_t begin_;
+};
+
+//-----------------------------------------------------------------------------
+inline const uint64_t StopwatchClock::now() const
+{
+#ifdef DFLY_HAVE_RDTSC
+  if (tsc_)
+    return __rdtsc();
+#endif
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+//-----------------------------------------------------------------------------
+inline const uint64_t Stopwatch::lapTicks()
+{
+  const uint64_t now = clock_.now();
+  const uint64_t lap = now - begin_;
+  begin_ = now;
+  return lap;
+}
+
+//-----------------------------------------------------------------------------
+inline ScopedTimer::~ScopedTimer()
+{
+  const uint64_t ticks = clock_.now() - begin_;
+  if (total_)
+    total_->add(ticks);
+  else
+    histogram_->recordNanos(clock_.toNanos(ticks));
+}
+
+} // namespace dragonfly
+
+#endif //__STOPWATCH_H__
@@ -0,0 +1,355 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "streamingdateparser.h"
+
+#include <cctype>
+#include <sstream>
+
+namespace dragonfly {
+
+// Named, rather than anonymous, so these don't collide with formatsniffer's
+// helpers when dflydate.h compiles both files into one translation unit.
+namespace streaming {
+  inline bool is_space(const char c)
+  { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+  inline bool is_digit(const char c)
+  { return c >= '0' && c <= '9'; }
+}
+
+// function:  StreamingDateParser constructor
+// params:    format: DateFormatter-style format string
+//            delimiter: byte separating records in the stream
+// purpose:   Breaks the format string down into a list of elements once, so
+//            that feeding bytes never has to look at the format string again.
+//            Throws DateBadFormatElement for tags the parser doesn't handle.
+//
+DFLY_INLINE
+StreamingDateParser::StreamingDateParser(const std::string& format,
+                                         const char delimiter)
+  : delimiter_(delimiter), offset_(0), errors_(0)
+{
+  for (std::string::size_type fi = 0; fi < format.size(); ++fi) {
+    Element e = { LITERAL, 0, format[fi], 0, false };
+    if (streaming::is_space(format[fi])) {
+      // A run of whitespace in the format matches any run in the text.
+      e.kind = SPACE;
+      if (!elements_.empty() && elements_.back().kind == SPACE)
+        continue;
+    }
+    else if (format[fi] == '%') {
+      if (++fi == format.size()) throw DateBadFormatElement();
+      e.fmt = format[fi];
+      switch (e.fmt) {
+        case '%':
+          e.literal = '%';
+          break;
+        case 'a': case 'A': case 'b': case 'B': case 'h': case 'p': case 'P':
+          e.kind = NAME;
+          break;
+        case 'e': case 'k': case 'l':
+          e.padded = true;
+          // fall through...
+        case 'C': case 'd': case 'H': case 'I': case 'm': case 'M':
+        case 'S': case 'y':
+          e.kind = NUMBER;
+          e.digits = 2;
+          break;
+        case 'Y':
+          e.kind = NUMBER;
+          e.digits = 4;
+          break;
+        default:
+          throw DateBadFormatElement();
+      }
+    }
+    elements_.push_back(e);
+  }
+
+  // The AM/PM indicators to match are whatever the global locale's
+  // time_put writes for %p and %P at midnight and at 1pm, taken once, here.
+  TimeStruct temp;
+  std::ostringstream os;
+  std::time_put<char> const& facet =
+    std::use_facet< std::time_put<char> >( os.getloc() );
+  const char upper[2] = { '%', 'p' };
+  const char lower[2] = { '%', 'P' };
+  facet.put(os, os, os.fill(), &temp, upper, upper + sizeof(upper));
+  am_upper_ = os.str(); os.str("");
+  facet.put(os, os, os.fill(), &temp, lower, lower + sizeof(lower));
+  am_lower_ = os.str(); os.str("");
+  temp.tm_hour = 13;
+  facet.put(os, os, os.fill(), &temp, upper, upper + sizeof(upper));
+  pm_upper_ = os.str(); os.str("");
+  facet.put(os, os, os.fill(), &temp, lower, lower + sizeof(lower));
+  pm_lower_ = os.str();
+
+  startRecord(0);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void StreamingDateParser::reset()
+{
+  offset_ = 0;
+  errors_ = 0;
+  startRecord(0);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void StreamingDateParser::startRecord(const unsigned long long at)
+{
+  state_ = MATCHING;
+  el_ = 0;
+  value_ = 0;
+  digits_ = 0;
+  nameLen_ = 0;
+  ampm_ = 0;
+  ts_ = TimeStruct();
+  start_ = end_ = at;
+  touched_ = false;
+}
+
+// function:  feed
+// params:    data, size: the next chunk of the stream
+//            out: completed timestamps are appended here
+// returns:   the number of timestamps appended
+// purpose:   Runs each byte of the chunk through the record state machine.
+//
+DFLY_INLINE
+size_t StreamingDateParser::feed(const char* data, size_t size,
+                                 std::vector<StreamedDate>& out)
+{
+  const size_t before = out.size();
+  for (const char* end = data + size; data != end; ++data, ++offset_) {
+    const char c = *data;
+    if (c == delimiter_) {
+      endRecord(out);
+      startRecord(offset_ + 1);
+    }
+    else if (state_ == MATCHING) {
+      touched_ = true;
+      step(c, out);
+    }
+  }
+  return out.size() - before;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+size_t StreamingDateParser::finish(std::vector<StreamedDate>& out)
+{
+  const size_t before = out.size();
+  endRecord(out);
+  startRecord(offset_);
+  return out.size() - before;
+}
+
+// function:  step
+// params:    c: next byte of the current record
+//            out: where to put the timestamp if c completes it
+// purpose:   Advances the match by one byte.  A byte that ends a variable
+//            length field (the '/' after a one-digit month, say) isn't part
+//            of that field, so after closing the field the same byte is run
+//            against the next element.
+//
+DFLY_INLINE
+void StreamingDateParser::step(const char c, std::vector<StreamedDate>& out)
+{
+  for (;;) {
+    if (el_ == elements_.size()) {
+      // Timestamp is complete; the rest of the record is none of our business.
+      emit(out);
+      state_ = SKIPPING;
+      return;
+    }
+
+    const Element& e = elements_[el_];
+    switch (e.kind) {
+      case LITERAL:
+        if (c != e.literal) {
+          fail();
+          return;
+        }
+        ++el_;
+        end_ = offset_ + 1;
+        break;
+
+      case SPACE:
+        if (!streaming::is_space(c)) {
+          ++el_;
+          continue;
+        }
+        end_ = offset_ + 1;
+        return;
+
+      case NUMBER:
+        if (streaming::is_digit(c)) {
+          value_ = value_ * 10 + (c - '0');
+          end_ = offset_ + 1;
+          if (++digits_ < e.digits)
+            return;
+          if (!storeNumber(e)) {
+            fail();
+            return;
+          }
+          ++el_;
+          break;
+        }
+        if (digits_ == 0 && c == ' ' && e.padded) {
+          end_ = offset_ + 1;
+          return;
+        }
+        if (digits_ == 0 || !storeNumber(e)) {
+          fail();
+          return;
+        }
+        ++el_;
+        continue;
+
+      case NAME:
+        if (!streaming::is_space(c) && !streaming::is_digit(c) &&
+            !abbrev_month_.is_delim(c)) {
+          if (nameLen_ == MAX_NAME_) {
+            fail();
+            return;
+          }
+          name_[nameLen_++] = c;
+          end_ = offset_ + 1;
+          return;
+        }
+        if (!storeName(e)) {
+          fail();
+          return;
+        }
+        ++el_;
+        continue;
+    }
+
+    // Only a byte that completed an element gets here.  If that was the
+    // last one, emit now instead of waiting for another byte.
+    if (el_ == elements_.size()) {
+      emit(out);
+      state_ = SKIPPING;
+    }
+    return;
+  }
+}
+
+// function:  endRecord
+// purpose:   Called on a delimiter (or at end-of-stream).  Whatever field
+//            was in progress is closed out, and if that completes the
+//            format the timestamp is emitted.  A record that was started
+//            but doesn't match is counted as an error; empty ones aren't.
+//
+DFLY_INLINE
+void StreamingDateParser::endRecord(std::vector<StreamedDate>& out)
+{
+  if (state_ != MATCHING || !touched_)
+    return;
+
+  while (el_ < elements_.size()) {
+    const Element& e = elements_[el_];
+    bool ok;
+    if (e.kind == SPACE)
+      ok = true;
+    else if (e.kind == NUMBER)
+      ok = digits_ > 0 && storeNumber(e);
+    else if (e.kind == NAME)
+      ok = storeName(e);
+    else
+      ok = false;
+
+    if (!ok) {
+      fail();
+      return;
+    }
+    ++el_;
+  }
+  emit(out);
+  state_ = SKIPPING;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+bool StreamingDateParser::storeNumber(const Element& e)
+{
+  const int v = value_;
+  value_ = 0;
+  digits_ = 0;
+  switch (e.fmt) {
+    case 'C': ts_.tm_year = v; break;
+    case 'd': case 'e': ts_.tm_mday = v; break;
+    case 'H': case 'k': case 'I': case 'l': ts_.tm_hour = v; break;
+    case 'm': ts_.tm_mon = v; break;
+    case 'M': ts_.tm_min = v; break;
+    case 'S': ts_.tm_sec = v; break;
+    case 'Y': ts_.tm_year = v; break;
+    case 'y': ts_.tm_year = v + (v < DateFormatter::WRAP_ ? 2000 : 1900); break;
+    default: return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+bool StreamingDateParser::storeName(const Element& e)
+{
+  const std::string name(name_, nameLen_);
+  nameLen_ = 0;
+  switch (e.fmt) {
+    case 'a': return abbrev_weekday_.find(name, ts_.tm_wday);
+    case 'A': return full_weekday_.find(name, ts_.tm_wday);
+    case 'b':
+    case 'h': return abbrev_month_.find(name, ts_.tm_mon);
+    case 'B': return full_month_.find(name, ts_.tm_mon);
+    case 'p':
+    case 'P':
+      if (name == pm_upper_ || name == pm_lower_)
+        ampm_ = 2;
+      else if (name == am_upper_ || name == am_lower_)
+        ampm_ = 1;
+      else
+        return false;
+      return true;
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+bool StreamingDateParser::emit(std::vector<StreamedDate>& out)
+{
+  if (ampm_ == 2 && ts_.tm_hour < 12)
+    ts_.tm_hour += 12;
+  else if (ampm_ == 1 && ts_.tm_hour == 12)
+    ts_.tm_hour = 0;
+
+  try {
+    StreamedDate found;
+    found.date = DateTime(ts_.tm_year, ts_.tm_mon, ts_.tm_mday,
+                          ts_.tm_hour, ts_.tm_min, ts_.tm_sec);
+    found.offset = start_;
+    found.length = static_cast<unsigned int>(end_ - start_);
+    out.push_back(found);
+    return true;
+  }
+  catch (const DateTimeException&) {
+    ++errors_;
+    return false;
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void StreamingDateParser::fail()
+{
+  ++errors_;
+  state_ = SKIPPING;
+}
+
+} // namespace dragonfly
@@ -0,0 +1,117 @@
+#ifndef __STREAMINGDATEPARSER_H__
+#define __STREAMINGDATEPARSER_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "datetime.h"
+#include "dateformatter.h"
+#include "dateexception.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace dragonfly {
+
+// struct:  StreamedDate
+// purpose: One timestamp pulled out of a byte stream by StreamingDateParser,
+//          along with where it was found.
+//
+struct StreamedDate {
+  DateTime date;
+  unsigned long long offset;  // stream offset of the timestamp's first byte
+  unsigned int length;        // number of bytes the timestamp occupied
+};
+
+// class:   StreamingDateParser
+// purpose: Parses timestamps out of a stream that arrives in arbitrary
+//          chunks (socket reads, pipe reads...).  The stream is treated as a
+//          series of records separated by a delimiter byte (a newline, by
+//          default), each of which begins with a timestamp in the given
+//          format.  Anything after the timestamp, up to the delimiter, is
+//          ignored.
+//
+//          All of the parse state lives in the object, so a timestamp split
+//          across two chunks is picked up where it left off; nothing is
+//          buffered or copied from the caller's chunks.  Records that don't
+//          match the format are skipped and counted in errors().
+//
+//          The format uses the same tags as DateFormatter::parse.  Numeric
+//          fields take up to their usual number of digits and end early at
+//          the first non-digit, so "4/7/2005" parses with "%m/%d/%Y".
+//
+class StreamingDateParser {
+  public:
+    StreamingDateParser(const std::string& format, const char delimiter = '\n');
+
+  public:
+    // Consumes size bytes, appending each completed timestamp to out.
+    // Returns the number of timestamps appended.
+    size_t feed(const char* data, size_t size, std::vector<StreamedDate>& out);
+
+    // Signals end-of-stream, completing a final record that had no trailing
+    // delimiter.  Offsets and the error count carry on until reset().
+    size_t finish(std::vector<StreamedDate>& out);
+
+    void reset();
+
+  public:
+    const unsigned long long offset() const { return offset_; }
+    const unsigned long long errors() const { return errors_; }
+
+  private:
+    enum Kind { LITERAL, SPACE, NUMBER, NAME };
+    enum State { MATCHING, SKIPPING };
+
+    struct Element {
+      Kind kind;
+      char fmt;           // format tag for NUMBER and NAME
+      char literal;       // the character to match for LITERAL
+      unsigned int digits;
+      bool padded;        // NUMBER may be blank padded (%e, %k, %l)
+    };
+
+  private:
+    void step(const char c, std::vector<StreamedDate>& out);
+    void endRecord(std::vector<StreamedDate>& out);
+    void startRecord(const unsigned long long at);
+    bool storeNumber(const Element& e);
+    bool storeName(const Element& e);
+    bool emit(std::vector<StreamedDate>& out);
+    void fail();
+
+  private:
+    static constexpr unsigned int MAX_NAME_ = 32;
+
+  private:
+    std::vector<Element> elements_;
+    char delimiter_;
+
+    // Per-record state.
+    State state_;
+    size_t el_;
+    int value_;
+    unsigned int digits_;
+    char name_[MAX_NAME_];
+    unsigned int nameLen_;
+    int ampm_;  // 0 none seen, 1 AM, 2 PM
+    TimeStruct ts_;
+    unsigned long long start_;
+    unsigned long long end_;
+    bool touched_;
+
+    unsigned long long offset_;
+    unsigned long long errors_;
+
+    AbbrevMonth abbrev_month_;
+    FullMonth full_month_;
+    AbbrevWeekday abbrev_weekday_;
+    FullWeekday full_weekday_;
+    std::string am_upper_, am_lower_, pm_upper_, pm_lower_;
+};
+
+} // namespace dragonfly
+
+#endif //__STREAMINGDATEPARSER_H__
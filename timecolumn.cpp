@@ -0,0 +1,314 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "timecolumn.h"
+
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace dragonfly {
+
+namespace {
+  const char MAGIC[8] = { 'D','F','L','Y','T','C','O','L' };
+  const uint32_t VERSION = 1;
+
+  // Zigzag folds signed deltas into unsigned ones so that small negative
+  // steps (slightly out-of-order timestamps) still encode in a byte or two.
+  inline uint64_t zigzag(const int64_t v)
+  { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+
+  inline int64_t unzigzag(const uint64_t v)
+  { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+TimeColumnWriter::TimeColumnWriter(const std::string& path,
+                                   TimeColumnEncoding encoding,
+                                   unsigned int blockSize)
+  : file_(0), encoding_(encoding), blockSize_(blockSize), count_(0),
+    offset_(0)
+{
+  if (blockSize_ == 0) throw DateColumnException();
+  file_ = std::fopen(path.c_str(), "wb");
+  if (!file_) throw DateColumnException();
+
+  // Placeholder header; the real one goes in once the counts are known.
+  TimeColumnHeader header;
+  std::memset(&header, 0, sizeof(header));
+  write(&header, sizeof(header));
+  pending_.reserve(blockSize_);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+TimeColumnWriter::~TimeColumnWriter()
+{
+  try {
+    close();
+  }
+  catch (...) {
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void TimeColumnWriter::write(const void* data, size_t size)
+{
+  if (std::fwrite(data, 1, size, file_) != size) throw DateColumnException();
+  offset_ += size;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void TimeColumnWriter::append(const packedtime_t value)
+{
+  if (!file_) throw DateColumnException();
+  pending_.push_back(value);
+  ++count_;
+  if (pending_.size() == blockSize_)
+    flushBlock();
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void TimeColumnWriter::flushBlock()
+{
+  if (pending_.empty()) return;
+
+  TimeColumnBlock block;
+  block.minValue = block.maxValue = block.firstValue = pending_[0];
+  block.offset = offset_;
+  block.count = static_cast<uint32_t>(pending_.size());
+  for (size_t i=1; i<pending_.size(); ++i) {
+    if (pending_[i] < block.minValue) block.minValue = pending_[i];
+    if (pending_[i] > block.maxValue) block.maxValue = pending_[i];
+  }
+
+  if (encoding_ == TIMECOLUMN_RAW) {
+    write(&pending_[0], pending_.size() * sizeof(packedtime_t));
+    block.bytes = static_cast<uint32_t>(pending_.size() * sizeof(packedtime_t));
+  }
+  else {
+    scratch_.clear();
+    for (size_t i=1; i<pending_.size(); ++i) {
+      uint64_t v = zigzag(pending_[i] - pending_[i-1]);
+      while (v >= 0x80) {
+        scratch_.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+      }
+      scratch_.push_back(static_cast<unsigned char>(v));
+    }
+    if (!scratch_.empty())
+      write(&scratch_[0], scratch_.size());
+    block.bytes = static_cast<uint32_t>(scratch_.size());
+  }
+
+  index_.push_back(block);
+  pending_.clear();
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void TimeColumnWriter::close()
+{
+  if (!file_) return;
+  flushBlock();
+
+  TimeColumnHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.encoding = encoding_;
+  header.count = count_;
+  header.blockSize = blockSize_;
+  header.blockCount = index_.size();
+  header.payloadBytes = offset_ - sizeof(TimeColumnHeader);
+
+  // Keep the index 8-byte aligned so the reader can use it in place.
+  static const char zeros[8] = { 0 };
+  if (offset_ % 8)
+    write(zeros, 8 - offset_ % 8);
+  header.indexOffset = offset_;
+  if (!index_.empty())
+    write(&index_[0], index_.size() * sizeof(TimeColumnBlock));
+
+  std::FILE* f = file_;
+  file_ = 0;
+  bool ok = std::fseek(f, 0, SEEK_SET) == 0 &&
+            std::fwrite(&header, 1, sizeof(header), f) == sizeof(header);
+  ok = (std::fclose(f) == 0) && ok;
+  if (!ok) throw DateColumnException();
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+TimeColumnReader::TimeColumnReader(const std::string& path)
+  : map_(0), mapSize_(0), header_(0), index_(0)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw DateColumnException();
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(TimeColumnHeader)) {
+    ::close(fd);
+    throw DateColumnException();
+  }
+
+  mapSize_ = static_cast<size_t>(st.st_size);
+  void* map = ::mmap(0, mapSize_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);  // the mapping keeps its own reference to the file.
+  if (map == MAP_FAILED) throw DateColumnException();
+  map_ = static_cast<const unsigned char*>(map);
+  header_ = reinterpret_cast<const TimeColumnHeader*>(map_);
+
+  // Only the header is checked here, against the file size, so opening a
+  // file is O(1) in its size.  That makes the payload, the index and (for
+  // a raw column) data()[0, size()) safe to read; the index entries
+  // themselves aren't trusted until decode() or scan() gets to them.
+  const TimeColumnHeader& h = *header_;
+  const uint64_t blockSize = h.blockSize;
+  bool ok = std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+            h.version == VERSION &&
+            (h.encoding == TIMECOLUMN_RAW || h.encoding == TIMECOLUMN_COMPRESSED) &&
+            blockSize > 0 &&
+            h.blockCount == (h.count + blockSize - 1) / blockSize &&
+            h.indexOffset % 8 == 0 &&
+            h.indexOffset >= sizeof(TimeColumnHeader) &&
+            h.indexOffset <= mapSize_ &&
+            h.payloadBytes <= h.indexOffset - sizeof(TimeColumnHeader) &&
+            h.blockCount <= (mapSize_ - h.indexOffset) / sizeof(TimeColumnBlock);
+  if (ok && h.encoding == TIMECOLUMN_RAW)
+    ok = h.payloadBytes % sizeof(packedtime_t) == 0 &&
+         h.payloadBytes / sizeof(packedtime_t) == h.count;
+  if (!ok) {
+    ::munmap(map, mapSize_);
+    throw DateColumnException();
+  }
+
+  index_ = reinterpret_cast<const TimeColumnBlock*>(map_ + h.indexOffset);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+TimeColumnReader::~TimeColumnReader()
+{
+  ::munmap(const_cast<unsigned char*>(map_), mapSize_);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const packedtime_t* TimeColumnReader::data() const
+{
+  if (encoding() != TIMECOLUMN_RAW) throw DateColumnException();
+  return reinterpret_cast<const packedtime_t*>(map_ + sizeof(TimeColumnHeader));
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const DateTime TimeColumnReader::at(const uint64_t i) const
+{
+  if (i >= size()) throw DateColumnException();
+
+  DateTime date;
+  if (encoding() == TIMECOLUMN_RAW) {
+    date.packed(data()[i]);
+  }
+  else {
+    std::vector<packedtime_t> values(blockSize());
+    decode(i / blockSize(), &values[0]);
+    date.packed(values[i % blockSize()]);
+  }
+  return date;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+unsigned int TimeColumnReader::decode(const uint64_t b, packedtime_t* out) const
+{
+  if (b >= blockCount()) throw DateColumnException();
+  const TimeColumnBlock& blk = index_[b];
+  if (blk.count > blockSize() || blk.offset > header_->indexOffset ||
+      blk.bytes > header_->indexOffset - blk.offset)
+    throw DateColumnException();
+
+  if (encoding() == TIMECOLUMN_RAW) {
+    if (blk.bytes != blk.count * sizeof(packedtime_t))
+      throw DateColumnException();
+    std::memcpy(out, map_ + blk.offset, blk.count * sizeof(packedtime_t));
+    return blk.count;
+  }
+
+  // Blocks are decoded one at a time, straight out of the mapping.  Running
+  // off the end of the block's bytes means the file is corrupt.
+  const unsigned char* p = map_ + blk.offset;
+  const unsigned char* end = p + blk.bytes;
+  packedtime_t value = blk.firstValue;
+  if (blk.count) out[0] = value;
+  for (uint32_t i=1; i<blk.count; ++i) {
+    uint64_t v = 0;
+    unsigned int shift = 0;
+    do {
+      if (p == end || shift > 63) throw DateColumnException();
+      v |= static_cast<uint64_t>(*p & 0x7f) << shift;
+      shift += 7;
+    } while (*p++ & 0x80);
+    value += unzigzag(v);
+    out[i] = value;
+  }
+  return blk.count;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+uint64_t TimeColumnReader::scan(const packedtime_t lo, const packedtime_t hi,
+                                std::vector<packedtime_t>& out) const
+{
+  uint64_t found = 0;
+  std::vector<packedtime_t> values;
+  for (uint64_t b=0; b<blockCount(); ++b) {
+    const TimeColumnBlock& blk = index_[b];
+    if (blk.maxValue < lo || blk.minValue > hi)
+      continue;
+
+    const packedtime_t* first;
+    const packedtime_t* last;
+    if (encoding() == TIMECOLUMN_RAW) {
+      // Block b starts at value b * blockSize(), which the header check
+      // puts inside the column; its count comes from the index, though.
+      const uint64_t start = b * blockSize();
+      if (blk.count > blockSize() || blk.count > size() - start)
+        throw DateColumnException();
+      first = data() + start;
+      last = first + blk.count;
+    }
+    else {
+      values.resize(blockSize());
+      last = &values[0] + decode(b, &values[0]);
+      first = &values[0];
+    }
+
+    if (blk.minValue >= lo && blk.maxValue <= hi) {
+      // Whole block is in range; no need to look at individual values.
+      out.insert(out.end(), first, last);
+      found += last - first;
+      continue;
+    }
+    for ( ; first != last; ++first) {
+      if (*first >= lo && *first <= hi) {
+        out.push_back(*first);
+        ++found;
+      }
+    }
+  }
+  return found;
+}
+
+} // namespace dragonfly
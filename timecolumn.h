@@ -0,0 +1,154 @@
+#ifndef __TIMECOLUMN_H__
+#define __TIMECOLUMN_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "datetime.h"
+#include "datetypes.h"
+#include "dateexception.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+namespace dragonfly {
+
+// On-disk layout of a timestamp column file.  Everything is stored in host
+// byte order; the magic number doubles as an endianness check.
+//
+//   TimeColumnHeader     64 bytes, always at offset zero.
+//   payload              Raw:        count packedtime_t values, back to back.
+//                        Compressed: for each block, the zigzag/varint encoded
+//                                    deltas between consecutive values (the
+//                                    block's first value lives in its index
+//                                    entry, so a block of one has no payload).
+//   TimeColumnBlock[]    One index entry per block, at header.indexOffset.
+//
+// Every block carries its min and max, so range scans can skip whole blocks
+// by looking only at the index.
+//
+struct TimeColumnHeader {
+  char     magic[8];        // "DFLYTCOL"
+  uint32_t version;
+  uint32_t encoding;        // TimeColumnEncoding
+  uint64_t count;           // total number of values
+  uint32_t blockSize;       // values per block (the last one may be short)
+  uint32_t reserved;
+  uint64_t blockCount;
+  uint64_t indexOffset;     // byte offset of the block index
+  uint64_t payloadBytes;    // bytes between the header and the index
+  uint64_t padding;
+};
+
+struct TimeColumnBlock {
+  packedtime_t minValue;
+  packedtime_t maxValue;
+  packedtime_t firstValue;
+  uint64_t     offset;      // byte offset of this block's payload in the file
+  uint32_t     count;
+  uint32_t     bytes;
+};
+
+enum TimeColumnEncoding {
+  TIMECOLUMN_RAW = 0,
+  TIMECOLUMN_COMPRESSED = 1
+};
+
+// class:   TimeColumnWriter
+// purpose: Streams timestamps into a column file.  Values are written as
+//          they're appended; only the block index is kept in memory, and
+//          it's written (along with the final header) by close().
+//
+class TimeColumnWriter {
+  public:
+    TimeColumnWriter(const std::string& path,
+                     TimeColumnEncoding encoding = TIMECOLUMN_RAW,
+                     unsigned int blockSize = DEFAULT_BLOCK_SIZE);
+    ~TimeColumnWriter();
+
+  public:
+    void append(const EpochCounter& date) { append(date.packed()); }
+    void append(const packedtime_t value);
+    void close();
+
+  public:
+    static constexpr unsigned int DEFAULT_BLOCK_SIZE = 4096;
+
+  private:
+    TimeColumnWriter(const TimeColumnWriter&);
+    TimeColumnWriter& operator= (const TimeColumnWriter&);
+    void flushBlock();
+    void write(const void* data, size_t size);
+
+  private:
+    std::FILE* file_;
+    TimeColumnEncoding encoding_;
+    unsigned int blockSize_;
+    uint64_t count_;
+    uint64_t offset_;
+    std::vector<TimeColumnBlock> index_;
+    std::vector<packedtime_t> pending_;
+    std::vector<unsigned char> scratch_;
+};
+
+// class:   TimeColumnReader
+// purpose: Read-only, memory-mapped view of a column file.  Opening the file
+//          only checks the header against the file size; nothing is parsed
+//          or copied until it's asked for.  Raw columns hand out a pointer
+//          straight into the mapping, compressed ones decode a block at a
+//          time into a caller-supplied buffer.
+//
+class TimeColumnReader {
+  public:
+    TimeColumnReader(const std::string& path);
+    ~TimeColumnReader();
+
+  public:
+    const uint64_t size() const { return header_->count; }
+    const TimeColumnEncoding encoding() const
+    { return static_cast<TimeColumnEncoding>(header_->encoding); }
+    const uint64_t blockCount() const { return header_->blockCount; }
+    const unsigned int blockSize() const { return header_->blockSize; }
+    const TimeColumnBlock& block(const uint64_t b) const { return index_[b]; }
+
+  public:
+    // Raw columns only.  Throws DateColumnException on a compressed column.
+    const packedtime_t* data() const;
+    const packedtime_t* begin() const { return data(); }
+    const packedtime_t* end() const { return data() + size(); }
+
+  public:
+    // Works for either encoding; on a compressed column this decodes the
+    // whole block containing the value, so prefer decode() for sequential
+    // access.
+    const DateTime at(const uint64_t i) const;
+
+    // Writes block b's values into out (which must hold blockSize() values),
+    // returning how many were written.
+    unsigned int decode(const uint64_t b, packedtime_t* out) const;
+
+    // Appends every value v with lo <= v <= hi to out, in file order.  Blocks
+    // whose min/max range misses [lo,hi] are skipped without being touched.
+    uint64_t scan(const packedtime_t lo, const packedtime_t hi,
+                  std::vector<packedtime_t>& out) const;
+    uint64_t scan(const EpochCounter& lo, const EpochCounter& hi,
+                  std::vector<packedtime_t>& out) const
+    { return scan(lo.packed(), hi.packed(), out); }
+
+  private:
+    TimeColumnReader(const TimeColumnReader&);
+    TimeColumnReader& operator= (const TimeColumnReader&);
+
+  private:
+    const unsigned char* map_;
+    size_t mapSize_;
+    const TimeColumnHeader* header_;
+    const TimeColumnBlock* index_;
+};
+
+} // namespace dragonfly
+
+#endif //__TIMECOLUMN_H__
@@ -0,0 +1,127 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "timemerge.h"
+
+#include <climits>
+
+namespace dragonfly {
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+TimeMerge::TimeMerge(const MergeSource* sources, const size_t k)
+  : winner_(0), remaining_(0)
+{
+  if (!k)
+    return;
+  size_t width = 1;
+  while (width < k)
+    width *= 2;
+
+  // The padding sources are empty, so they lose every match.
+  const Leaf empty = { 0, sizeof(packedtime_t), 0, 0 };
+  leaves_.assign(width, empty);
+  keys_.assign(width, LLONG_MAX);
+  for (size_t s = 0; s < k; ++s) {
+    Leaf& leaf = leaves_[s];
+    leaf.times = reinterpret_cast<const char*>(sources[s].times);
+    leaf.stride = sources[s].stride ? sources[s].stride : sizeof(packedtime_t);
+    leaf.size = sources[s].size;
+    if (leaf.size)
+      keys_[s] = time(leaf, 0);
+    remaining_ += leaf.size;
+  }
+
+  // Play every match bottom up, keeping each node's loser and passing its
+  // winner up.
+  std::vector<unsigned int> winners(2 * width);
+  for (size_t s = 0; s < width; ++s)
+    winners[width + s] = static_cast<unsigned int>(s);
+  losers_.resize(width);
+  for (size_t node = width - 1; node >= 1; --node) {
+    const unsigned int a = winners[2 * node], b = winners[2 * node + 1];
+    const bool aWins = before(a, b);
+    winners[node] = aWins ? a : b;
+    losers_[node] = aWins ? b : a;
+  }
+  winner_ = winners[1];
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void TimeMerge::replay(const unsigned int s, const size_t position)
+{
+  Leaf& leaf = leaves_[s];
+  leaf.position = position;
+  keys_[s] = position < leaf.size ? time(leaf, position) : LLONG_MAX;
+
+  // Who wins each match is anyone's guess, so pick without branching.
+  unsigned int w = s;
+  for (size_t node = (s + leaves_.size()) / 2; node >= 1; node /= 2) {
+    const unsigned int other = losers_[node];
+    const bool lost = before(other, w);
+    losers_[node] = lost ? w : other;
+    w = lost ? other : w;
+  }
+  winner_ = w;
+}
+
+// function:  next
+// purpose:   Takes the winner's record and replays.  If the winner wins
+//            again, the best source it beat on the way up is the runner-up,
+//            and the run goes on for as long as the winner's records come
+//            before the runner-up's next one.
+//
+DFLY_INLINE
+const bool TimeMerge::next(MergeRun& run)
+{
+  if (empty())
+    return false;
+  const unsigned int w = winner_;
+  const Leaf& leaf = leaves_[w];
+  const size_t begin = leaf.position;
+  size_t end = begin + 1;
+  replay(w, end);
+
+  if (winner_ == w && end < leaf.size) {
+    const size_t width = leaves_.size();
+    size_t node = (w + width) / 2;
+    unsigned int r = node ? losers_[node] : w;
+    for (node /= 2; node >= 1; node /= 2)
+      if (before(losers_[node], r))
+        r = losers_[node];
+
+    ++end;      // the record at begin + 1 just won
+    if (r == w || done(r))
+      end = leaf.size;
+    else if (w < r)
+      for (const packedtime_t bound = keys_[r];
+           end < leaf.size && time(leaf, end) <= bound; ++end)
+        ;
+    else
+      for (const packedtime_t bound = keys_[r];
+           end < leaf.size && time(leaf, end) < bound; ++end)
+        ;
+    replay(w, end);
+  }
+
+  run.source = w;
+  run.begin = begin;
+  run.end = end;
+  remaining_ -= end - begin;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const size_t TimeMerge::pull(MergeRun* runs, const size_t max)
+{
+  size_t n = 0;
+  while (n < max && next(runs[n]))
+    ++n;
+  return n;
+}
+
+} // namespace dragonfly
@@ -0,0 +1,115 @@
+#ifndef __TIMEMERGE_H__
+#define __TIMEMERGE_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "datetime.h"
+#include "datetypes.h"
+#include <vector>
+#include <cstddef>
+
+namespace dragonfly {
+
+// struct:  MergeSource
+// purpose: One time-ordered input to a TimeMerge: the packed times of size
+//          records, each stride bytes after the one before, so times can
+//          point at the time field of the caller's first record.  A stride
+//          of 0 means a plain array of packedtime_t.
+//
+struct MergeSource {
+  const packedtime_t* times;
+  size_t size;
+  size_t stride;
+};
+
+// struct:  MergeRun
+// purpose: Records [begin, end) of one source, next in the merged order.
+//
+struct MergeRun {
+  unsigned int source;
+  size_t begin;
+  size_t end;
+};
+
+// class:   TimeMerge
+// purpose: Merges k time-ordered sources into one time-ordered sequence,
+//          as runs of consecutive records from one source at a time.
+//          Records are never moved or copied: like TimeIndex, a run says
+//          where the records are in the caller's own arrays.  Equal times
+//          come out in source order, so the merge is stable.
+//
+//          The sources sit in a loser tree: each internal node holds the
+//          source that lost the match played there, and the overall winner
+//          is kept aside.  Taking a record replays only the winner's path
+//          to the root, log2(k) comparisons of cached 64-bit keys.  When
+//          the winner wins again, it's ahead of everything on its path, and
+//          the best of those is the bound for the rest of its run: records
+//          are then taken one comparison each, with no replay, until one
+//          passes the bound.  Sources that interleave record by record cost
+//          log2(k) a record; sources that come in bursts, as shards of a
+//          log usually do, cost about one comparison a record.
+//
+//          Not thread safe.  The sources must outlive the merge.
+//
+class TimeMerge {
+  public:
+    // Each source must be sorted by time.  k may be 0.
+    TimeMerge(const MergeSource* sources, const size_t k);
+
+  public:
+    // The next run.  Returns false when every source is used up.
+    const bool next(MergeRun& run);
+    // Up to max runs; returns how many.  0 means the merge is done.
+    const size_t pull(MergeRun* runs, const size_t max);
+
+  public:
+    const bool empty() const { return leaves_.empty() || done(winner_); }
+    // Records not yet returned.
+    const size_t remaining() const { return remaining_; }
+
+  private:
+    struct Leaf {
+      const char* times;
+      size_t stride;
+      size_t size;
+      size_t position;
+    };
+
+    const packedtime_t time(const Leaf& leaf, const size_t i) const
+    { return *reinterpret_cast<const packedtime_t*>(leaf.times + i * leaf.stride); }
+    const bool done(const unsigned int s) const
+    { return leaves_[s].position == leaves_[s].size; }
+    // Does source a's next record come before source b's?
+    const bool before(const unsigned int a, const unsigned int b) const;
+    // Moves source s on to record position and plays it up to the root.
+    void replay(const unsigned int s, const size_t position);
+
+  private:
+    std::vector<Leaf> leaves_;          // k sources, padded to a power of 2
+    // Each source's time at its position, LLONG_MAX once it's used up; kept
+    // apart from leaves_ so the matches read a tight array.
+    std::vector<packedtime_t> keys_;
+    std::vector<unsigned int> losers_;  // internal nodes 1..leaves_.size()-1
+    unsigned int winner_;
+    size_t remaining_;
+};
+
+//-----------------------------------------------------------------------------
+inline const bool TimeMerge::before(const unsigned int a,
+                                    const unsigned int b) const
+{
+  if (keys_[a] != keys_[b])
+    return keys_[a] < keys_[b];
+  // Only a tie, or a used-up source (whose key is the largest there is),
+  // gets this far.
+  if (done(a) || done(b))
+    return !done(a);
+  return a < b;
+}
+
+} // namespace dragonfly
+
+#endif //__TIMEMERGE_H__
@@ -0,0 +1,194 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "timerangefilter.h"
+
+#include <cstring>
+
+namespace dragonfly {
+
+namespace {
+  // Field ranks, most significant first.
+  enum { RANK_YEAR, RANK_MONTH, RANK_DAY, RANK_HOUR, RANK_MINUTE,
+         RANK_SECOND, RANK_NONE = -1 };
+
+  // function:  sortedPrecision
+  // returns:   the rank of the last field, if the pattern's text sorts in
+  //            time order (see TimeRangeFilter); RANK_NONE if it doesn't.
+  //
+  int sortedPrecision(const std::string& pattern)
+  {
+    int last = RANK_NONE;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+      if (pattern[i] != '%')
+        continue;
+      if (++i == pattern.size())
+        return RANK_NONE;
+      int rank, after;  // this field, and the one it has to follow
+      switch (pattern[i]) {
+        case '%': continue;
+        case 'Y': rank = RANK_YEAR; after = RANK_NONE; break;
+        case 'm': rank = RANK_MONTH; after = RANK_YEAR; break;
+        case 'd':
+        case 'e': rank = RANK_DAY; after = RANK_MONTH; break;
+        case 'j': rank = RANK_DAY; after = RANK_YEAR; break;
+        case 'H':
+        case 'k': rank = RANK_HOUR; after = RANK_DAY; break;
+        case 'M': rank = RANK_MINUTE; after = RANK_HOUR; break;
+        case 'S': rank = RANK_SECOND; after = RANK_MINUTE; break;
+        default: return RANK_NONE;
+      }
+      if (after != last)
+        return RANK_NONE;
+      last = rank;
+    }
+    return last;
+  }
+
+  // function:  ceilTo
+  // purpose:   The first time at or after when that a pattern ending in a
+  //            field of the given rank can hold.
+  //
+  const DateTime ceilTo(const DateTime& when, const int rank)
+  {
+    const int y = when.year(), m = when.month();
+    DateTime t;
+    switch (rank) {
+      case RANK_YEAR: t = DateTime(y, 1, 1); break;
+      case RANK_MONTH: t = DateTime(y, m, 1); break;
+      case RANK_DAY: t = DateTime(y, m, when.day()); break;
+      case RANK_HOUR: t = DateTime(y, m, when.day(), when.hour(), 0, 0); break;
+      case RANK_MINUTE:
+        t = DateTime(y, m, when.day(), when.hour(), when.minute(), 0);
+        break;
+      default:
+        t = DateTime(y, m, when.day(), when.hour(), when.minute(),
+                     when.second());
+    }
+    if (t.packed() == when.packed())
+      return t;
+    switch (rank) {
+      case RANK_YEAR: return DateTime(y + 1, 1, 1);
+      case RANK_MONTH: return m == 12 ? DateTime(y + 1, 1, 1) : DateTime(y, m + 1, 1);
+    }
+    static const packedtime_t units[] = {
+      0, 0, EpochCounter::TICKS_PER_DAY, EpochCounter::TICKS_PER_HOUR,
+      EpochCounter::TICKS_PER_MINUTE, EpochCounter::TICKS_PER_SECOND };
+    t.packed(t.packed() + units[rank]);
+    return t;
+  }
+
+  // function:  bigEndianWord
+  // purpose:   8 bytes of text as a number that compares the way the bytes
+  //            do, or fewer zero-filled on the right.
+  //
+  inline uint64_t bigEndianWord(const char* text, const size_t length)
+  {
+    uint64_t word = 0;
+    if (length >= 8) {
+      std::memcpy(&word, text, 8);
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      word = __builtin_bswap64(word);
+#endif
+    }
+    else
+      for (size_t i = 0; i < length; ++i)
+        word |= static_cast<uint64_t>(static_cast<unsigned char>(text[i]))
+                << (56 - 8 * i);
+    return word;
+  }
+
+  // Where word i of a width-byte field starts.
+  inline size_t wordOffset(const size_t i, const size_t width)
+  {
+    return width < 8 ? 0 : (8 * i + 8 <= width ? 8 * i : width - 8);
+  }
+
+  void toWords(const std::string& text, std::vector<uint64_t>& words)
+  {
+    const size_t n = text.size() < 8 ? 1 : (text.size() + 7) / 8;
+    for (size_t i = 0; i < n; ++i)
+      words.push_back(bigEndianWord(text.data() + wordOffset(i, text.size()),
+                                    text.size()));
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+TimeRangeFilter::TimeRangeFilter(const DateFormatter& formatter,
+                                 const DateTime& from, const DateTime& to)
+  : formatter_(formatter), from_(from.packed()), to_(to.packed()), width_(0)
+{
+  const int precision = sortedPrecision(formatter.pattern());
+  if (precision == RANK_NONE)
+    return;
+
+  // A text holding the time t is in range when from <= t < to.  t is a
+  // whole number of the last field's units, so that's the same as
+  // ceil(from) <= t < ceil(to), and those two format to the byte bounds.
+  const DateTime low = ceilTo(from, precision);
+  const DateTime high = ceilTo(to, precision);
+  from_ = low.packed();
+  to_ = high.packed();
+  if (low.year() < 1000 || high.year() > 9999)
+    return;
+  const std::string lowText = formatter.format(low);
+  const std::string highText = formatter.format(high);
+  if (lowText.size() != highText.size() || lowText.empty())
+    return;
+  width_ = lowText.size();
+  toWords(lowText, low_);
+  toWords(highText, high_);
+}
+
+// function:  contains
+// purpose:   Compares the text with both bounds in one pass, a word at a
+//            time, stopping as soon as both comparisons are decided.
+//
+DFLY_INLINE
+const bool TimeRangeFilter::contains(const char* text,
+                                     const size_t length) const
+{
+  if (!width_)
+    return parsedContains(text, length);
+  if (length < width_)
+    return false;
+
+  // Each comparison is decided by the first word that differs.
+  bool aboveLow = false, belowHigh = false;
+  for (size_t i = 0; i < low_.size(); ++i) {
+    const uint64_t word = bigEndianWord(text + wordOffset(i, width_), width_);
+    if (!aboveLow && word != low_[i]) {
+      if (word < low_[i])
+        return false;
+      aboveLow = true;
+    }
+    if (!belowHigh && word != high_[i]) {
+      if (word > high_[i])
+        return false;
+      belowHigh = true;
+    }
+    if (aboveLow && belowHigh)
+      return true;
+  }
+  return belowHigh;  // equal to low is in, equal to high isn't
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const bool TimeRangeFilter::parsedContains(const char* text,
+                                           const size_t length) const
+{
+  try {
+    unsigned int used;
+    const packedtime_t t = formatter_.parse(text, length, used).packed();
+    return from_ <= t && t < to_;
+  }
+  catch (const std::exception&) {
+    return false;
+  }
+}
+
+} // namespace dragonfly
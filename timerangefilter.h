@@ -0,0 +1,76 @@
+#ifndef __TIMERANGEFILTER_H__
+#define __TIMERANGEFILTER_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "datetime.h"
+#include "datetypes.h"
+#include "dateformatter.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace dragonfly {
+
+// class:   TimeRangeFilter
+// purpose: "Is the timestamp at the start of this text in [from, to)?",
+//          for scanning logs and other text for a time range without
+//          parsing every line.
+//
+//          Some patterns sort as text in the same order as the times they
+//          hold: fixed-width fields from the year down, most significant
+//          first, with anything but fields in between, e.g.
+//          "%Y-%m-%d %H:%M:%S", "%Y%m%d%H%M%S" or "[%Y/%j %H:%M]".  The
+//          fields allowed are %Y, then %m and %d (or %e), or %j, then %H
+//          (or %k), %M and %S, stopping at any point.  For those the bounds
+//          are formatted once and each text's bytes are compared with them
+//          directly, eight at a time, with no parsing and no checking:
+//          text that isn't in the format falls wherever its bytes put it.
+//          Any other pattern, or bounds outside the years 1000 to 9999, and
+//          each text is parsed instead, and text that doesn't parse is out
+//          of range.
+//
+//          Either way, a text is in range when the time it holds is: a
+//          pattern without seconds (say) holds whole minutes, and the
+//          minute 10:05 is in range if 10:05:00 is.
+//
+class TimeRangeFilter {
+  public:
+    TimeRangeFilter(const DateFormatter& formatter, const DateTime& from,
+                    const DateTime& to);
+
+  public:
+    // text, length: the text, starting with the timestamp.  Anything after
+    // the timestamp is ignored.
+    const bool contains(const char* text, const size_t length) const;
+    const bool contains(const std::string& text) const
+    { return contains(text.data(), text.size()); }
+
+  public:
+    // Whether texts are compared as bytes rather than parsed.
+    const bool direct() const { return width_ != 0; }
+    // How many characters of each text are compared; 0 when parsing.
+    const size_t width() const { return width_; }
+
+  private:
+    const bool parsedContains(const char* text, const size_t length) const;
+
+  private:
+    DateFormatter formatter_;
+    packedtime_t from_;
+    packedtime_t to_;
+    size_t width_;
+    // The bounds as big-endian words, covering the first width_ bytes
+    // eight at a time; the last word overlaps the one before it when
+    // width_ isn't a multiple of 8.
+    std::vector<uint64_t> low_;
+    std::vector<uint64_t> high_;
+};
+
+} // namespace dragonfly
+
+#endif //__TIMERANGEFILTER_H__
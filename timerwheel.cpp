@@ -0,0 +1,229 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "timerwheel.h"
+
+namespace dragonfly {
+
+namespace {
+  // How many entries ahead advance() asks for the generation counts of,
+  // while firing a slot.
+  const size_t TIMER_PREFETCH = 8;
+
+  // cancel() leaves at least this many entries behind before sweeping.
+  const size_t TIMER_SWEEP_MIN = 4096;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+TimerWheel::TimerWheel(const DateTime& start, const size_t capacity)
+  : free_(NIL), elapsed_(start.packed()), size_(0), cancelled_(0)
+{
+  nodes_.reserve(capacity);
+  for (int i = 0; i < LEVELS; ++i)
+    occupied_[i] = 0;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const TimerId TimerWheel::schedule(const DateTime& deadline, void* data)
+{
+  return schedule(deadline.packed(), data);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const TimerId TimerWheel::scheduleIn(const Duration& delay, void* data)
+{
+  return schedule(elapsed_ + delay.packed(), data);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const TimerId TimerWheel::schedule(const packedtime_t deadline, void* data)
+{
+  if (deadline < 0 || deadline >= LIMIT)
+    throw DateValueOutOfRangeException();
+
+  uint32_t node = free_;
+  if (node != NIL)
+    free_ = nodes_[node].next;
+  else {
+    if (nodes_.size() >= NIL)
+      throw DateValueOutOfRangeException();
+    const Node fresh = { 1, NIL };
+    node = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(fresh);
+  }
+  const Entry e = { deadline, data, node, nodes_[node].generation };
+  place(e);
+  ++size_;
+  return static_cast<TimerId>(e.generation) << 32 | node;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const bool TimerWheel::cancel(const TimerId id)
+{
+  const uint32_t node = static_cast<uint32_t>(id);
+  // A free node's count is the one its next timer will get, so it can't
+  // match an id that's been handed out.
+  if (node >= nodes_.size() ||
+      nodes_[node].generation != static_cast<uint32_t>(id >> 32))
+    return false;
+  release(node);
+  if (++cancelled_ > size_ && cancelled_ >= TIMER_SWEEP_MIN)
+    sweep();
+  return true;
+}
+
+// function:  place
+// purpose:   Adds an entry to the slot for its deadline.  The level is the
+//            6-bit group holding the highest bit where the deadline and the
+//            wheel's time differ, and the slot is the deadline's bits in
+//            that group -- always ahead of the wheel's own slot on that
+//            level, since the deadline is later.  Past deadlines go in the
+//            current level-0 slot.
+//
+DFLY_INLINE
+void TimerWheel::place(const Entry& entry)
+{
+  const packedtime_t due = entry.deadline > elapsed_ ? entry.deadline : elapsed_;
+  const uint64_t diff = static_cast<uint64_t>(due ^ elapsed_);
+  const int level = diff ? (63 - __builtin_clzll(diff)) / SLOT_BITS : 0;
+  const int slot = static_cast<int>(due >> (level * SLOT_BITS)) & (SLOTS - 1);
+  slots_[level * SLOTS + slot].push_back(entry);
+  occupied_[level] |= static_cast<uint64_t>(1) << slot;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void TimerWheel::release(const uint32_t node)
+{
+  Node& n = nodes_[node];
+  if (++n.generation == 0)
+    n.generation = 1;
+  n.next = free_;
+  free_ = node;
+  --size_;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void TimerWheel::sweep()
+{
+  for (int i = 0; i < LEVELS * SLOTS; ++i) {
+    std::vector<Entry>& slot = slots_[i];
+    size_t kept = 0;
+    for (size_t j = 0; j < slot.size(); ++j)
+      if (live(slot[j]))
+        slot[kept++] = slot[j];
+    slot.resize(kept);
+    if (!kept)
+      occupied_[i / SLOTS] &= ~(static_cast<uint64_t>(1) << (i % SLOTS));
+  }
+  cancelled_ = 0;
+}
+
+// function:  nextSlot
+// purpose:   Every timer on a level is due before every timer on the levels
+//            above it, so the first occupied slot, at or after the wheel's
+//            own slot, on the lowest occupied level is the next one due.
+//
+DFLY_INLINE
+const bool TimerWheel::nextSlot(int& slot, packedtime_t& when) const
+{
+  for (int level = 0; level < LEVELS; ++level) {
+    if (!occupied_[level])
+      continue;
+    const int shift = level * SLOT_BITS;
+    const int current = static_cast<int>(elapsed_ >> shift) & (SLOTS - 1);
+    const uint64_t ahead = occupied_[level] & (~static_cast<uint64_t>(0) << current);
+    const int s = __builtin_ctzll(ahead);
+    const packedtime_t base =
+      elapsed_ & ~((static_cast<packedtime_t>(1) << (shift + SLOT_BITS)) - 1);
+    slot = level * SLOTS + s;
+    when = base | static_cast<packedtime_t>(s) << shift;
+    return true;
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const bool TimerWheel::nextWake(packedtime_t& when) const
+{
+  int slot;
+  return size_ && nextSlot(slot, when);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const size_t TimerWheel::advance(const DateTime& now, ExpiryCallback callback,
+                                 void* user)
+{
+  return advance(now.packed(), callback, user);
+}
+
+// function:  advance
+// purpose:   Jumps from one occupied slot to the next until the next is
+//            after now.  A level-0 slot's timers are all due at its tick and
+//            fire; a higher slot's timers are placed again from the slot's
+//            start, which puts them on lower levels.  The callback runs
+//            once, at the end, so it sees the wheel already at now.
+//
+DFLY_INLINE
+const size_t TimerWheel::advance(const packedtime_t now,
+                                 ExpiryCallback callback, void* user)
+{
+  fired_.clear();
+  int slot;
+  packedtime_t when;
+  while (nextSlot(slot, when) && when <= now) {
+    if (when > elapsed_)
+      elapsed_ = when;
+    // Emptying a slot only ever adds to lower levels, never to itself.
+    // Cancelled timers' entries go down with the rest and are only
+    // checked for at level 0, so cascading never leaves the slot's array.
+    std::vector<Entry>& list = slots_[slot];
+    occupied_[slot / SLOTS] &= ~(static_cast<uint64_t>(1) << (slot % SLOTS));
+    const size_t count = list.size();
+    if (slot < SLOTS) {
+      for (size_t i = 0; i < count; ++i) {
+        if (i + TIMER_PREFETCH < count)
+          __builtin_prefetch(&nodes_[list[i + TIMER_PREFETCH].node]);
+        const Entry& e = list[i];
+        if (!live(e)) {
+          --cancelled_;
+          continue;
+        }
+        const TimerExpiry x = {
+          static_cast<TimerId>(e.generation) << 32 | e.node, e.deadline, e.data };
+        fired_.push_back(x);
+        release(e.node);
+      }
+    }
+    else
+      for (size_t i = 0; i < count; ++i)
+        place(list[i]);
+    list.clear();
+  }
+  if (now > elapsed_)
+    elapsed_ = now;
+  if (!fired_.empty() && callback)
+    callback(&fired_[0], fired_.size(), user);
+  return fired_.size();
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const DateTime TimerWheel::now() const
+{
+  DateTime d;
+  d.packed(elapsed_);
+  return d;
+}
+
+} // namespace dragonfly
@@ -0,0 +1,141 @@
+#ifndef __TIMERWHEEL_H__
+#define __TIMERWHEEL_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "datetime.h"
+#include "duration.h"
+#include "datetypes.h"
+#include "dateexception.h"
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace dragonfly {
+
+// Identifies a scheduled timer.  Never 0.  Ids carry a generation count, so
+// cancelling a timer that has already fired or been cancelled is a harmless
+// no-op even after its storage has gone to a newer timer.
+typedef unsigned long long TimerId;
+
+// struct:  TimerExpiry
+// purpose: One fired timer, as handed to an ExpiryCallback.
+//
+struct TimerExpiry {
+  TimerId id;
+  packedtime_t deadline;   // as scheduled, even if it was already past
+  void* data;              // as passed to schedule()
+};
+
+// Called once per advance() with everything that fired, earliest tick first.
+// The callback may schedule and cancel timers, but mustn't call advance().
+typedef void (*ExpiryCallback)(const TimerExpiry* expired, size_t n,
+                               void* user);
+
+// class:   TimerWheel
+// purpose: Timeouts and delayed jobs keyed by DateTime deadlines, with
+//          amortized constant-time schedule, cancel and expiry.
+//
+//          The wheel ticks in milliseconds, the same ticks as EpochCounter.
+//          It never reads a clock: its time is whatever the caller last
+//          passed to advance(), so it runs the same against the system
+//          clock, an event stream's timestamps, or a simulated clock in a
+//          test.
+//
+//          Nine levels of 64 slots each cover every DateTime.  Level 0
+//          holds the timers due in the current 64ms, one slot per tick;
+//          each level up has slots 64 times wider, and the top levels are
+//          the overflow for deadlines years out.  A timer goes on the level
+//          of the highest bit where its deadline and the wheel's time
+//          differ, so scheduling is a few bit operations and an append.
+//          When advance() reaches a slot above level 0 its timers drop to
+//          lower levels, at most once per level, and a per-level bitmap
+//          of occupied slots lets advance() jump straight to the next one,
+//          however far away it is.
+//
+//          Not thread safe.
+//
+class TimerWheel {
+  public:
+    // start: the wheel's time until the first advance().  capacity: timers
+    // to make room for up front.
+    TimerWheel(const DateTime& start, const size_t capacity = 0);
+
+  public:
+    // A deadline at or before now() fires on the next advance().  Throws
+    // DateValueOutOfRangeException for a deadline before 0 A.D.
+    const TimerId schedule(const DateTime& deadline, void* data = 0);
+    const TimerId schedule(const packedtime_t deadline, void* data = 0);
+    // Relative to now().
+    const TimerId scheduleIn(const Duration& delay, void* data = 0);
+
+    // Returns false if the timer had already fired or been cancelled.  The
+    // timer's slot entry is left where it is and skipped when its slot
+    // comes due; once they outnumber the live timers they're swept out.
+    const bool cancel(const TimerId id);
+
+    // Moves the wheel's time forward to now, firing every timer due by
+    // then (deadline <= now) through callback.  Returns how many fired.
+    // A now before now() fires nothing and doesn't move the time back.
+    const size_t advance(const DateTime& now, ExpiryCallback callback,
+                         void* user = 0);
+    const size_t advance(const packedtime_t now, ExpiryCallback callback,
+                         void* user = 0);
+
+  public:
+    const DateTime now() const;
+    const size_t size() const { return size_; }
+    const bool empty() const { return size_ == 0; }
+    // The earliest time advance() could fire anything: exact when the next
+    // deadline is within 64ms, a lower bound further out.  Returns false if
+    // nothing is scheduled.
+    const bool nextWake(packedtime_t& when) const;
+
+  private:
+    static constexpr int LEVELS = 9;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr uint32_t NIL = 0xffffffffu;
+    static constexpr packedtime_t LIMIT =
+      static_cast<packedtime_t>(1) << (LEVELS * SLOT_BITS);
+
+    // A timer as it sits in a slot.  Emptying a slot reads and appends
+    // these in sequence; the only other memory a timer has is the
+    // generation count that says whether it's still scheduled.
+    struct Entry {
+      packedtime_t deadline;
+      void* data;
+      uint32_t node;
+      uint32_t generation;
+    };
+    struct Node {
+      uint32_t generation;   // bumped when the timer fires or is cancelled
+      uint32_t next;         // the next free node, while this one's free
+    };
+
+    void place(const Entry& entry);
+    const bool live(const Entry& entry) const
+    { return nodes_[entry.node].generation == entry.generation; }
+    void release(const uint32_t node);
+    // Drops every cancelled timer's entry.
+    void sweep();
+    // The first occupied slot (level * SLOTS + slot) and when it's due.
+    const bool nextSlot(int& slot, packedtime_t& when) const;
+
+  private:
+    std::vector<Node> nodes_;
+    uint32_t free_;
+    std::vector<Entry> slots_[LEVELS * SLOTS];
+    uint64_t occupied_[LEVELS];
+    packedtime_t elapsed_;
+    size_t size_;
+    size_t cancelled_;       // entries left behind by cancel()
+    std::vector<TimerExpiry> fired_;
+};
+
+} // namespace dragonfly
+
+#endif //__TIMERWHEEL_H__
@@ -0,0 +1,186 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "timesort.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace dragonfly {
+
+namespace {
+  // Below this many elements std::stable_sort wins.
+  const size_t SMALL_SORT = 256;
+
+  // Each thread should get at least this many elements per pass.
+  const size_t MIN_PER_THREAD = 1 << 16;
+
+  const int RADIX_BITS = 8;
+  const size_t RADIX = 1 << RADIX_BITS;
+
+  inline packedtime_t timeOf(const packedtime_t t) { return t; }
+  inline packedtime_t timeOf(const TimeIndex& p) { return p.time; }
+
+  template <class T>
+  inline bool earlier(const T& a, const T& b)
+  { return timeOf(a) < timeOf(b); }
+
+  const unsigned int threadCount(unsigned int threads, const size_t n)
+  {
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t useful = std::max<size_t>(1, n / MIN_PER_THREAD);
+    return static_cast<unsigned int>(std::min<size_t>(threads, useful));
+  }
+
+  // function:  parallelFor
+  // purpose:   Runs fn(0) .. fn(threads-1) at once, fn(0) on this thread.
+  //
+  template <class Fn>
+  void parallelFor(const unsigned int threads, Fn fn)
+  {
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; ++t)
+      pool.push_back(std::thread(fn, t));
+    fn(0);
+    for (size_t t = 0; t < pool.size(); ++t)
+      pool[t].join();
+  }
+
+  // function:  radixSort
+  // purpose:   Stable LSD radix sort on timeOf(element) - smallest time,
+  //            one byte per pass, skipping the high bytes that are zero for
+  //            every key and any pass where every key has the same digit.
+  //            Each thread counts and then scatters its own slice of the
+  //            array; the per-thread histograms are laid end to end so
+  //            thread t's elements with digit d land right after thread
+  //            t-1's, which keeps the sort stable.
+  //
+  template <class T>
+  void radixSort(T* data, const size_t n, const unsigned int threads)
+  {
+    if (n < SMALL_SORT) {
+      std::stable_sort(data, data + n, earlier<T>);
+      return;
+    }
+
+    std::vector<packedtime_t> lows(threads), highs(threads);
+    parallelFor(threads, [&](const unsigned int t) {
+      const size_t begin = n * t / threads, end = n * (t + 1) / threads;
+      packedtime_t lo = timeOf(data[begin]), hi = lo;
+      for (size_t i = begin + 1; i < end; ++i) {
+        lo = std::min(lo, timeOf(data[i]));
+        hi = std::max(hi, timeOf(data[i]));
+      }
+      lows[t] = lo;
+      highs[t] = hi;
+    });
+    const uint64_t base =
+      static_cast<uint64_t>(*std::min_element(lows.begin(), lows.end()));
+    const uint64_t range =
+      static_cast<uint64_t>(*std::max_element(highs.begin(), highs.end())) - base;
+
+    int passes = 0;
+    while (passes < 64 / RADIX_BITS && (range >> (passes * RADIX_BITS)))
+      ++passes;
+
+    std::unique_ptr<T[]> scratch(new T[n]);
+    T* src = data;
+    T* dst = scratch.get();
+    std::vector<size_t> counts(threads * RADIX);
+
+    for (int pass = 0; pass < passes; ++pass) {
+      const int shift = pass * RADIX_BITS;
+      parallelFor(threads, [&](const unsigned int t) {
+        size_t* count = &counts[t * RADIX];
+        std::fill(count, count + RADIX, 0);
+        const size_t begin = n * t / threads, end = n * (t + 1) / threads;
+        for (size_t i = begin; i < end; ++i)
+          ++count[((static_cast<uint64_t>(timeOf(src[i])) - base) >> shift)
+                  & (RADIX - 1)];
+      });
+
+      // Turn the counts into starting offsets, digit-major, thread-minor.
+      size_t offset = 0;
+      bool trivial = false;
+      for (size_t d = 0; d < RADIX; ++d) {
+        const size_t start = offset;
+        for (unsigned int t = 0; t < threads; ++t) {
+          const size_t c = counts[t * RADIX + d];
+          counts[t * RADIX + d] = offset;
+          offset += c;
+        }
+        if (offset - start == n)
+          trivial = true;
+      }
+      if (trivial)
+        continue;
+
+      parallelFor(threads, [&](const unsigned int t) {
+        size_t* next = &counts[t * RADIX];
+        const size_t begin = n * t / threads, end = n * (t + 1) / threads;
+        for (size_t i = begin; i < end; ++i)
+          dst[next[((static_cast<uint64_t>(timeOf(src[i])) - base) >> shift)
+                   & (RADIX - 1)]++] = src[i];
+      });
+      std::swap(src, dst);
+    }
+
+    if (src != data)
+      std::copy(src, src + n, data);
+  }
+
+  // DateTimes are sorted by way of their packed values; equal times are
+  // indistinguishable, so writing them back in order is all it takes.
+  void sortDates(DateTime* dates, const size_t n, const unsigned int threads)
+  {
+    std::unique_ptr<packedtime_t[]> times(new packedtime_t[n]);
+    parallelFor(threads, [&](const unsigned int t) {
+      for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i)
+        times[i] = dates[i].packed();
+    });
+    radixSort(times.get(), n, threads);
+    parallelFor(threads, [&](const unsigned int t) {
+      for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i)
+        dates[i].packed(times[i]);
+    });
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void sortTimes(packedtime_t* times, const size_t n)
+{ radixSort(times, n, 1); }
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void sortTimes(DateTime* dates, const size_t n)
+{ sortDates(dates, n, 1); }
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void sortTimes(TimeIndex* pairs, const size_t n)
+{ radixSort(pairs, n, 1); }
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void sortTimesParallel(packedtime_t* times, const size_t n,
+                       unsigned int threads)
+{ radixSort(times, n, threadCount(threads, n)); }
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void sortTimesParallel(DateTime* dates, const size_t n, unsigned int threads)
+{ sortDates(dates, n, threadCount(threads, n)); }
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void sortTimesParallel(TimeIndex* pairs, const size_t n, unsigned int threads)
+{ radixSort(pairs, n, threadCount(threads, n)); }
+
+} // namespace dragonfly
@@ -0,0 +1,52 @@
+#ifndef __TIMESORT_H__
+#define __TIMESORT_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Radix sorts for arrays of timestamps.
+//
+// Timestamps are sorted on their packed value (see EpochCounter::packed),
+// which orders the same way as DateTime's operator<.  Keys are taken
+// relative to the smallest timestamp in the array, so only the bytes that
+// actually vary get a pass: a day's worth of millisecond timestamps takes
+// four passes, not eight.  The sorts are stable, need a scratch buffer the
+// size of the input, and fall back to std::stable_sort for small arrays.
+//
+// The parallel versions split every pass across threads, each with its
+// own histogram, and write to disjoint parts of the output.  threads = 0
+// means one per core.  Arrays too small to be worth it are sorted on the
+// calling thread.
+
+#include "datetime.h"
+#include "datetypes.h"
+#include <cstddef>
+
+namespace dragonfly {
+
+// struct:  TimeIndex
+// purpose: A timestamp and the position of whatever it stamps in the
+//          caller's own arrays, for sorting payloads by time without moving
+//          them.
+//
+struct TimeIndex {
+  packedtime_t time;
+  size_t index;
+};
+
+void sortTimes(packedtime_t* times, const size_t n);
+void sortTimes(DateTime* dates, const size_t n);
+void sortTimes(TimeIndex* pairs, const size_t n);
+
+void sortTimesParallel(packedtime_t* times, const size_t n,
+                       unsigned int threads = 0);
+void sortTimesParallel(DateTime* dates, const size_t n,
+                       unsigned int threads = 0);
+void sortTimesParallel(TimeIndex* pairs, const size_t n,
+                       unsigned int threads = 0);
+
+} // namespace dragonfly
+
+#endif //__TIMESORT_H__
@@ -0,0 +1,272 @@
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "timewindow.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cmath>
+
+namespace dragonfly {
+
+namespace {
+  inline WindowStats emptyStats()
+  {
+    WindowStats s = { 0, 0.0, HUGE_VAL, -HUGE_VAL };
+    return s;
+  }
+
+  inline void merge(WindowStats& into, const WindowStats& from)
+  {
+    into.count += from.count;
+    into.sum += from.sum;
+    into.min = std::min(into.min, from.min);
+    into.max = std::max(into.max, from.max);
+  }
+
+  // Rounds towards negative infinity, unlike '/'.
+  inline long long floorDiv(const long long a, const long long b)
+  { return a / b - (a % b < 0); }
+
+  inline size_t ringSlot(const long long bucket, const unsigned int buckets)
+  {
+    const long long m = bucket % static_cast<long long>(buckets);
+    return static_cast<size_t>(m < 0 ? m + buckets : m);
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+TimeWindow::TimeWindow(const Duration& width, const unsigned int buckets)
+  : width_(width.packed()), buckets_(buckets), leaves_(1), head_(NONE),
+    late_(0)
+{
+  if (width_ <= 0 || buckets_ == 0)
+    throw DateValueOutOfRangeException();
+  while (leaves_ < buckets_)
+    leaves_ *= 2;
+  tree_.assign(2 * leaves_, emptyStats());
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const long long TimeWindow::bucketOf(const DateTime& when) const
+{ return floorDiv(when.packed(), width_); }
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const bool TimeWindow::add(const DateTime& when, const double value)
+{
+  const long long b = bucketOf(when);
+  if (head_ == NONE || b > head_)
+    advanceTo(b);
+  else if (b <= head_ - buckets_) {
+    ++late_;
+    return false;
+  }
+
+  const size_t slot = ringSlot(b, buckets_);
+  Node leaf = tree_[leaves_ + slot];
+  ++leaf.count;
+  leaf.sum += value;
+  leaf.min = std::min(leaf.min, value);
+  leaf.max = std::max(leaf.max, value);
+  update(slot, leaf);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void TimeWindow::advance(const DateTime& now)
+{
+  const long long b = bucketOf(now);
+  if (head_ == NONE || b > head_)
+    advanceTo(b);
+}
+
+// function:  advanceTo
+// purpose:   Makes bucket the newest one, emptying the slots of every bucket
+//            that falls out of the ring on the way.  A jump past the whole
+//            ring just clears the tree.
+//
+DFLY_INLINE
+void TimeWindow::advanceTo(const long long bucket)
+{
+  if (head_ == NONE || bucket - head_ >= static_cast<long long>(buckets_))
+    std::fill(tree_.begin(), tree_.end(), emptyStats());
+  else
+    for (long long b = head_ + 1; b <= bucket; ++b)
+      update(ringSlot(b, buckets_), emptyStats());
+  head_ = bucket;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void TimeWindow::update(size_t slot, const Node& value)
+{
+  size_t i = leaves_ + slot;
+  tree_[i] = value;
+  for (i /= 2; i >= 1; i /= 2) {
+    tree_[i] = tree_[2 * i];
+    merge(tree_[i], tree_[2 * i + 1]);
+  }
+}
+
+// function:  range
+// params:    lo, hi: ring slots, inclusive, lo <= hi
+// returns:   the leaves in between, merged.
+//
+DFLY_INLINE
+const TimeWindow::Node TimeWindow::range(size_t lo, size_t hi) const
+{
+  Node result = emptyStats();
+  for (lo += leaves_, hi += leaves_ + 1; lo < hi; lo /= 2, hi /= 2) {
+    if (lo & 1) merge(result, tree_[lo++]);
+    if (hi & 1) merge(result, tree_[--hi]);
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const WindowStats TimeWindow::stats(long long first, const long long last) const
+{
+  if (head_ == NONE)
+    return emptyStats();
+  first = std::max(first, head_ - buckets_ + 1);
+  const long long end = std::min(last, head_);
+  if (first > end)
+    return emptyStats();
+
+  // The buckets may wrap around the end of the ring.
+  const size_t lo = ringSlot(first, buckets_), hi = ringSlot(end, buckets_);
+  if (lo <= hi)
+    return range(lo, hi);
+  Node result = range(lo, buckets_ - 1);
+  merge(result, range(0, hi));
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const WindowStats TimeWindow::query(const unsigned int n) const
+{
+  if (head_ == NONE || n == 0)
+    return emptyStats();
+  return stats(head_ - std::min(n, buckets_) + 1, head_);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const double TimeWindow::rate(const unsigned int n) const
+{
+  const unsigned int k = std::min(n, buckets_);
+  if (k == 0)
+    return 0.0;
+  return query(k).count * static_cast<double>(EpochCounter::TICKS_PER_SECOND)
+         / (static_cast<double>(width_) * k);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const DateTime TimeWindow::newest() const
+{
+  DateTime start;
+  if (head_ != NONE)
+    start.packed(head_ * width_);
+  return start;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+ShardedTimeWindow::ShardedTimeWindow(const Duration& width,
+                                     const unsigned int buckets,
+                                     unsigned int shards)
+{
+  if (shards == 0)
+    shards = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned int s = 0; s < shards; ++s)
+    shards_.push_back(std::unique_ptr<Shard>(new Shard(width, buckets)));
+}
+
+// function:  local
+// purpose:   The calling thread's shard.  Threads are numbered in the order
+//            they first get here, so the first `shards` threads each get a
+//            shard to themselves.
+//
+DFLY_INLINE
+ShardedTimeWindow::Shard& ShardedTimeWindow::local()
+{
+  static std::atomic<unsigned int> threads(0);
+  static thread_local const unsigned int id = threads++;
+  return *shards_[id % shards_.size()];
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const bool ShardedTimeWindow::add(const DateTime& when, const double value)
+{
+  Shard& shard = local();
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.window.add(when, value);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+void ShardedTimeWindow::advance(const DateTime& now)
+{
+  for (size_t s = 0; s < shards_.size(); ++s) {
+    std::lock_guard<std::mutex> lock(shards_[s]->mutex);
+    shards_[s]->window.advance(now);
+  }
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const WindowStats ShardedTimeWindow::query(const unsigned int n) const
+{
+  // Lock everything first, so the shards are merged as of one moment.
+  std::vector<std::unique_lock<std::mutex> > locks;
+  long long head = TimeWindow::NONE;
+  for (size_t s = 0; s < shards_.size(); ++s) {
+    locks.push_back(std::unique_lock<std::mutex>(shards_[s]->mutex));
+    head = std::max(head, shards_[s]->window.head_);
+  }
+
+  WindowStats result = emptyStats();
+  const unsigned int k = std::min(n, shards_[0]->window.buckets());
+  if (head == TimeWindow::NONE || k == 0)
+    return result;
+  for (size_t s = 0; s < shards_.size(); ++s)
+    merge(result, shards_[s]->window.stats(head - k + 1, head));
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const double ShardedTimeWindow::rate(const unsigned int n) const
+{
+  const TimeWindow& first = shards_[0]->window;
+  const unsigned int k = std::min(n, first.buckets());
+  if (k == 0)
+    return 0.0;
+  return query(k).count * static_cast<double>(EpochCounter::TICKS_PER_SECOND)
+         / (static_cast<double>(first.width()) * k);
+}
+
+//-----------------------------------------------------------------------------
+DFLY_INLINE
+const unsigned long long ShardedTimeWindow::late() const
+{
+  unsigned long long total = 0;
+  for (size_t s = 0; s < shards_.size(); ++s) {
+    std::lock_guard<std::mutex> lock(shards_[s]->mutex);
+    total += shards_[s]->window.late();
+  }
+  return total;
+}
+
+} // namespace dragonfly
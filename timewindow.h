@@ -0,0 +1,144 @@
+#ifndef __TIMEWINDOW_H__
+#define __TIMEWINDOW_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "datetime.h"
+#include "duration.h"
+#include "datetypes.h"
+#include "dateexception.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <climits>
+
+namespace dragonfly {
+
+// struct:  WindowStats
+// purpose: What a TimeWindow query returns.  min and max are +/-HUGE_VAL
+//          when count is zero.
+//
+struct WindowStats {
+  unsigned long long count;
+  double sum;
+  double min;
+  double max;
+};
+
+// class:   TimeWindow
+// purpose: Rolling count/sum/min/max of values stamped with DateTimes, kept
+//          in a ring of fixed-width time buckets.
+//
+//          Buckets start at whole multiples of the width counted from the
+//          library's epoch, so any width that divides a day (a second, a
+//          minute, 15 minutes, an hour, a day) lines up with the clock:
+//          minute buckets start on the minute.  The ring holds the newest
+//          `buckets` of them.  An event newer than the newest bucket moves
+//          the ring forward, expiring the buckets that fall off the back;
+//          an event in a bucket that's still held is added to it, so
+//          slightly out-of-order input is fine; anything older than that is
+//          dropped and counted in late().
+//
+//          Under the ring is a segment tree, so adding an event, expiring a
+//          bucket, and querying any number of the newest buckets each cost
+//          O(log buckets) -- nothing is rescanned.
+//
+//          Not thread safe; see ShardedTimeWindow.
+//
+class TimeWindow {
+  public:
+    // width: a positive Duration, e.g. Minutes(1).  Throws
+    // DateValueOutOfRangeException if width or buckets is zero.
+    TimeWindow(const Duration& width, const unsigned int buckets);
+
+  public:
+    // Returns false if the event was too old to keep.
+    const bool add(const DateTime& when, const double value = 1.0);
+
+    // Moves the ring forward to now's bucket (if it's not there already)
+    // without adding anything, e.g. on a timer while events are quiet.
+    void advance(const DateTime& now);
+
+  public:
+    // Stats over the newest n buckets (all of them if n is more than the
+    // ring holds), including the current, partly-filled one.
+    const WindowStats query(const unsigned int n) const;
+
+    // Events per second over the newest n buckets.
+    const double rate(const unsigned int n) const;
+
+  public:
+    const unsigned int buckets() const { return buckets_; }
+    const packedtime_t width() const { return width_; }
+    // Start of the newest bucket; 0 A.D. if nothing's been added.
+    const DateTime newest() const;
+    const unsigned long long late() const { return late_; }
+
+  private:
+    friend class ShardedTimeWindow;
+
+    typedef WindowStats Node;
+    static constexpr long long NONE = LLONG_MIN;
+
+    const long long bucketOf(const DateTime& when) const;
+    void advanceTo(const long long bucket);
+    void update(size_t slot, const Node& value);
+    const Node range(size_t lo, size_t hi) const;
+    // Stats over absolute buckets [first, last], clipped to what's held.
+    const WindowStats stats(long long first, const long long last) const;
+
+  private:
+    packedtime_t width_;
+    unsigned int buckets_;
+    size_t leaves_;             // power of two >= buckets_
+    std::vector<Node> tree_;    // tree_[1] is the root, leaves at leaves_
+    long long head_;            // newest bucket, or NONE
+    unsigned long long late_;
+};
+
+// class:   ShardedTimeWindow
+// purpose: A TimeWindow for many writer threads.  Each thread is assigned
+//          a shard, with its own lock and ring, the first time it adds an
+//          event, so writers on different shards never touch the same lock
+//          or cache line.  Queries lock each shard in turn and merge them,
+//          lined up on the newest bucket any shard has seen.
+//
+class ShardedTimeWindow {
+  public:
+    // shards = 0 means one per core.
+    ShardedTimeWindow(const Duration& width, const unsigned int buckets,
+                      unsigned int shards = 0);
+
+  public:
+    const bool add(const DateTime& when, const double value = 1.0);
+    void advance(const DateTime& now);
+
+  public:
+    const WindowStats query(const unsigned int n) const;
+    const double rate(const unsigned int n) const;
+    const unsigned long long late() const;
+    const unsigned int shards() const
+    { return static_cast<unsigned int>(shards_.size()); }
+
+  private:
+    ShardedTimeWindow(const ShardedTimeWindow&);
+    ShardedTimeWindow& operator= (const ShardedTimeWindow&);
+
+    struct alignas(64) Shard {
+      Shard(const Duration& width, const unsigned int buckets)
+        : window(width, buckets) {}
+      mutable std::mutex mutex;
+      TimeWindow window;
+    };
+    Shard& local();
+
+  private:
+    std::vector<std::unique_ptr<Shard> > shards_;
+};
+
+} // namespace dragonfly
+
+#endif //__TIMEWINDOW_H__
@@ -0,0 +1,191 @@
+#ifndef __UNIXTIME_H__
+#define __UNIXTIME_H__
+
+// Copyright 2006 Mike Desjardins.
+// Distributed under the Boost Software License, Version 1.0. (See
+// accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Conversions between DateTime/Duration and the usual Unix representations:
+// time_t, struct timespec, and std::chrono.  These work on the packed tick
+// count directly -- converting a Unix timestamp is a multiply and an add,
+// with no trip through the calendar or struct tm.
+//
+// The library counts milliseconds, so anything finer (the nanoseconds in a
+// timespec, or a chrono duration in microseconds) is floored to the
+// millisecond on the way in.  Going out is exact.
+//
+// Values that don't fit in a DateTime (about 5.8 million years either side
+// of 0 A.D.) throw DateValueOutOfRangeException.
+
+#include "datetime.h"
+#include "duration.h"
+#include "dateexception.h"
+#include "dateinstrument.h"
+#include <ctime>
+#include <chrono>
+#include <climits>
+
+namespace dragonfly {
+
+// Days from the library's epoch (Jan 1, 0 A.D.) to Jan 1, 1970.
+const datecount_t UNIX_EPOCH_DAYS = 719527;
+const packedtime_t UNIX_EPOCH_TICKS =
+  static_cast<packedtime_t>(UNIX_EPOCH_DAYS) * EpochCounter::TICKS_PER_DAY;
+
+// Range of Unix milliseconds that fit in a DateTime.
+const packedtime_t MIN_UNIX_MILLIS =
+  static_cast<packedtime_t>(INT_MIN) * EpochCounter::TICKS_PER_DAY
+  - UNIX_EPOCH_TICKS;
+const packedtime_t MAX_UNIX_MILLIS =
+  static_cast<packedtime_t>(INT_MAX) * EpochCounter::TICKS_PER_DAY
+  + (EpochCounter::TICKS_PER_DAY - 1) - UNIX_EPOCH_TICKS;
+
+typedef std::chrono::time_point<std::chrono::system_clock,
+                                std::chrono::milliseconds> UnixTimePoint;
+
+//-----------------------------------------------------------------------------
+// function:  fromUnixMillis
+// params:    millis: milliseconds since Jan 1, 1970 00:00:00 UTC
+// returns:   the same instant as a DateTime.
+//
+inline const DateTime fromUnixMillis(const packedtime_t millis)
+{
+  if (millis < MIN_UNIX_MILLIS || millis > MAX_UNIX_MILLIS) {
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
+  DateTime result;
+  result.packed(millis + UNIX_EPOCH_TICKS);
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+inline const DateTime fromUnixTime(const time_t seconds)
+{
+  const packedtime_t s = seconds;
+  if (s < MIN_UNIX_MILLIS / EpochCounter::TICKS_PER_SECOND ||
+      s > MAX_UNIX_MILLIS / EpochCounter::TICKS_PER_SECOND) {
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
+  return fromUnixMillis(s * EpochCounter::TICKS_PER_SECOND);
+}
+
+//-----------------------------------------------------------------------------
+// tv_nsec is expected to be normalized, i.e. within [0, 1000000000).
+//
+inline const DateTime fromTimespec(const struct timespec& ts)
+{
+  const packedtime_t s = ts.tv_sec;
+  if (s < MIN_UNIX_MILLIS / EpochCounter::TICKS_PER_SECOND ||
+      s > MAX_UNIX_MILLIS / EpochCounter::TICKS_PER_SECOND) {
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
+  return fromUnixMillis(s * EpochCounter::TICKS_PER_SECOND
+                        + ts.tv_nsec / 1000000);
+}
+
+//-----------------------------------------------------------------------------
+// Takes a system_clock time_point of any precision.
+//
+template <class D>
+inline const DateTime fromTimePoint(
+  const std::chrono::time_point<std::chrono::system_clock, D>& tp)
+{
+  typedef std::chrono::duration<long double, std::milli> fmillis;
+  const fmillis ms = tp.time_since_epoch();
+  if (ms.count() < MIN_UNIX_MILLIS || ms.count() > MAX_UNIX_MILLIS) {
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
+  return fromUnixMillis(
+    std::chrono::floor<std::chrono::milliseconds>(tp.time_since_epoch()).count());
+}
+
+//-----------------------------------------------------------------------------
+// function:  toUnixMillis
+// params:    date: any date, before or after 1970
+// returns:   milliseconds since Jan 1, 1970 00:00:00 UTC.
+//
+inline const packedtime_t toUnixMillis(const Gregorian& date)
+{ return date.packed() - UNIX_EPOCH_TICKS; }
+
+//-----------------------------------------------------------------------------
+// Seconds since 1970, rounded down.
+//
+inline const time_t toUnixTime(const Gregorian& date)
+{
+  const packedtime_t ms = toUnixMillis(date);
+  packedtime_t s = ms / EpochCounter::TICKS_PER_SECOND;
+  if (ms % EpochCounter::TICKS_PER_SECOND < 0)
+    --s;
+  return static_cast<time_t>(s);
+}
+
+//-----------------------------------------------------------------------------
+inline const struct timespec toTimespec(const Gregorian& date)
+{
+  const packedtime_t ms = toUnixMillis(date);
+  struct timespec ts;
+  ts.tv_sec = toUnixTime(date);
+  ts.tv_nsec = static_cast<long>(
+    (ms - static_cast<packedtime_t>(ts.tv_sec) * EpochCounter::TICKS_PER_SECOND)
+    * 1000000);
+  return ts;
+}
+
+//-----------------------------------------------------------------------------
+// Converts implicitly to std::chrono::system_clock::time_point.
+//
+inline const UnixTimePoint toTimePoint(const Gregorian& date)
+{ return UnixTimePoint(std::chrono::milliseconds(toUnixMillis(date))); }
+
+//-----------------------------------------------------------------------------
+// function:  fromChrono
+// params:    d: any std::chrono::duration; may be negative
+// returns:   the same length of time as a Duration, floored to the
+//            millisecond.
+//
+template <class Rep, class Period>
+inline const Duration fromChrono(const std::chrono::duration<Rep, Period>& d)
+{
+  typedef std::chrono::duration<long double, std::milli> fmillis;
+  const fmillis ms = d;
+  const long double limit =
+    static_cast<long double>(INT_MAX) * EpochCounter::TICKS_PER_DAY;
+  if (ms.count() < -limit || ms.count() > limit) {
+    DFLY_COUNT(EXCEPTIONS);
+    throw DateValueOutOfRangeException();
+  }
+  EpochCounter result;
+  result.packed(std::chrono::floor<std::chrono::milliseconds>(d).count());
+  return Duration(result);
+}
+
+//-----------------------------------------------------------------------------
+// Converts implicitly to any finer std::chrono::duration.
+//
+inline const std::chrono::milliseconds toChrono(const Duration& d)
+{ return std::chrono::milliseconds(d.packed()); }
+
+//-----------------------------------------------------------------------------
+// The Duration as a (normalized) timespec, e.g. for nanosleep.
+//
+inline const struct timespec toTimespec(const Duration& d)
+{
+  const packedtime_t ms = d.packed();
+  packedtime_t s = ms / EpochCounter::TICKS_PER_SECOND;
+  if (ms % EpochCounter::TICKS_PER_SECOND < 0)
+    --s;
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(s);
+  ts.tv_nsec = static_cast<long>((ms - s * EpochCounter::TICKS_PER_SECOND)
+                                 * 1000000);
+  return ts;
+}
+
+} // namespace dragonfly
+
+#endif //__UNIXTIME_H__